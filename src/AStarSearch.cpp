@@ -0,0 +1,198 @@
+#include "AStarSearch.h"
+#include "RobotRelevance.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	AStarSearch::AStarSearch(Map const& map, Goal const& goal, AStarOptions const& options) :
+			m_map(map), m_goalTest(goal), m_options(options), m_start(map.state()),
+			m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()),
+			m_expanded(0u), m_solutionLength(0u), m_limitReached(false), m_interrupted(false)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("AStarSearch: Board too large");
+		}
+		if (m_options.depthLimit >= UNREACHABLE) {
+			throw std::invalid_argument("AStarSearch: Depth limit too large");
+		}
+		if (m_options.weight == 0u) {
+			throw std::invalid_argument("AStarSearch: Weight must be positive");
+		}
+		for (auto c: RobotColors) {
+			if (!map.posValid(map.getRobotPos(c))) {
+				continue;
+			}
+			if (m_options.robots.empty() || std::find(m_options.robots.cbegin(), m_options.robots.cend(), c) != m_options.robots.cend()) {
+				m_robots.push_back(c);
+			}
+		}
+		if (m_options.pruneRobots && !m_robots.empty()) {
+			m_robots = RobotRelevance(map, goal, m_robots).relevantRobots(m_options.depthLimit);
+		}
+		if (!m_options.heuristic) {
+			m_goalDistances.emplace(map, goal, m_robots);
+		}
+	}
+
+	unsigned AStarSearch::heuristic(Map::State const& state, GoalTest::flags_t flags) const {
+		if (m_options.heuristic) {
+			return m_options.heuristic(state, flags);
+		}
+		return m_goalDistances->lowerBound(state);
+	}
+
+	std::uint32_t& AStarSearch::slot(key_t k) {
+		std::size_t const mask = m_table.size() - 1u;
+		std::size_t i = static_cast<std::size_t>((k * 0x9E3779B97F4A7C15ull) >> 32u) & mask;
+		while (m_table[i] != NONE && m_nodes[m_table[i]].key != k) {
+			i = (i + 1u) & mask;
+		}
+		return m_table[i];
+	}
+
+	void AStarSearch::grow() {
+		m_table.assign(std::max<std::size_t>(m_table.size() * 2u, 1024u), NONE);
+		for (std::uint32_t i = 0u; i < m_nodes.size(); i++) {
+			slot(m_nodes[i].key) = i;
+		}
+	}
+
+	std::optional<MoveSequence> AStarSearch::solve() {
+		m_nodes.clear();
+		m_table.clear();
+		unsigned const weight = m_options.weight;
+		m_buckets.assign((m_options.depthLimit + 1u) * (weight + 1u), {});
+		m_expanded = 0u;
+		m_solutionLength = 0u;
+		m_limitReached = false;
+		m_interrupted = false;
+		grow();
+
+		// Cost of the best solution found, and its last move
+		unsigned best = m_options.depthLimit + 1u;
+		std::uint32_t bestParent = NONE;
+		std::uint8_t bestMove = 0u;
+
+		unsigned const h = heuristic(m_start, 0u);
+		unsigned f = 0u;
+		auto queue = [&](std::uint32_t index, unsigned bucket) {
+			m_buckets[bucket].push_back(index);
+			// With weight, a successor may fall below the current bucket
+			f = std::min(f, bucket);
+		};
+		if (h < best) {
+			m_nodes.push_back({ key(m_start, 0u), NONE, 0u, 0u, static_cast<std::uint8_t>(h) });
+			slot(m_nodes.back().key) = 0u;
+			f = weight * h;
+			queue(0u, f);
+		}
+
+		// Without weight, no state left can lead to a shorter solution once
+		// f reaches the best one; with weight, take the first solution
+		auto searching = [&]() {
+			return weight == 1u ? f < best : bestParent == NONE;
+		};
+		while (f < m_buckets.size() && searching()) {
+			std::vector<std::uint32_t>& bucket = m_buckets[f];
+			if (bucket.empty()) {
+				f++;
+				continue;
+			}
+			std::uint32_t const index = bucket.back();
+			bucket.pop_back();
+			Node const node = m_nodes[index];
+			if (node.g + weight * node.h != f) {
+				// Queued again with fewer moves
+				continue;
+			}
+			if ((++m_expanded & 0xFFu) == 0u && m_options.interrupt && m_options.interrupt()) {
+				m_interrupted = true;
+				return std::nullopt;
+			}
+
+			Map::State const state = m_map.unpack(node.key & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+			GoalTest::flags_t const flags = static_cast<GoalTest::flags_t>(node.key >> m_flagShift);
+			unsigned const g = node.g + 1u;
+			for (auto c: m_robots) {
+				for (auto requested: AllDirections) {
+					m_map.loadState(state);
+					Direction dir = requested;
+					if (!m_map.moveRobot(c, dir)) {
+						continue;
+					}
+					std::uint8_t const move = encodeMove({ c, requested });
+					if (m_goalTest.finishes(m_map, c, requested, flags)) {
+						if (g < best) {
+							best = g;
+							bestParent = index;
+							bestMove = move;
+						}
+						continue;
+					}
+
+					GoalTest::flags_t const childFlags = m_goalTest.update(flags, c, dir);
+					key_t const childKey = key(m_map.state(), childFlags);
+					std::uint32_t& existing = slot(childKey);
+					if (existing != NONE) {
+						Node& child = m_nodes[existing];
+						if (child.g <= g || child.h + g >= best) {
+							continue;
+						}
+						child.g = static_cast<std::uint8_t>(g);
+						child.parent = index;
+						child.move = move;
+						queue(existing, g + weight * child.h);
+						continue;
+					}
+
+					unsigned const childH = heuristic(m_map.state(), childFlags);
+					if (g + childH >= best) {
+						continue;
+					}
+					existing = static_cast<std::uint32_t>(m_nodes.size());
+					m_nodes.push_back({ childKey, index, move, static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(childH) });
+					queue(existing, g + weight * childH);
+					if (m_options.maxStates != 0u && m_nodes.size() > m_options.maxStates) {
+						m_limitReached = true;
+						return std::nullopt;
+					}
+					if (m_nodes.size() * 2u > m_table.size()) {
+						grow();
+					}
+				}
+			}
+		}
+
+		m_solutionLength = best;
+		if (bestParent == NONE) {
+			return std::nullopt;
+		}
+		MoveSequence moves;
+		moves.push_back(decodeMove(bestMove));
+		for (std::uint32_t i = bestParent; m_nodes[i].parent != NONE; i = m_nodes[i].parent) {
+			moves.push_back(decodeMove(m_nodes[i].move));
+		}
+		std::reverse(moves.begin(), moves.end());
+		return moves;
+	}
+
+	void AStarSearch::learnedBounds(std::function<void(Map::State const&, GoalTest::flags_t, unsigned)> const& visit, std::size_t limit) const {
+		if (m_solutionLength == 0u || m_limitReached || m_interrupted || m_options.weight != 1u) {
+			return;
+		}
+		std::size_t reported = 0u;
+		for (Node const& node: m_nodes) {
+			if (node.g + node.h >= m_solutionLength) {
+				continue;
+			}
+			if (reported++ == limit) {
+				break;
+			}
+			Map::State const state = m_map.unpack(node.key & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+			visit(state, static_cast<GoalTest::flags_t>(node.key >> m_flagShift), m_solutionLength - node.g);
+		}
+	}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalDistances.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace ricochet {
+
+	struct AStarOptions {
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 20u;
+		/// Give up once this many states are stored, 0 for no limit
+		std::size_t maxStates = 0u;
+		/**
+		 * Lower bound on the number of moves to the goal, e.g. from a
+		 * PatternDatabase. Values above depthLimit prune the state.
+		 * If empty, the distance of the closest goal robot on its own is
+		 * used, allowing it to stop anywhere.
+		 */
+		std::function<unsigned(Map::State const&, GoalTest::flags_t)> heuristic;
+		/**
+		 * Factor applied to the heuristic when ordering states. Above 1
+		 * the first solution found is returned, which is at most this many
+		 * times longer than an optimal one.
+		 */
+		unsigned weight = 1u;
+		/// Polled during the search, which gives up once it returns true
+		std::function<bool()> interrupt;
+		/// Leave robots where they are that can not affect the goal robots within depthLimit moves, see RobotRelevance
+		bool pruneRobots = true;
+	};
+
+	/**
+	 * Solver using A* with small integer costs, optimal unless the
+	 * heuristic is weighted.
+	 * Open states are kept in one bucket per f-value, taken from the
+	 * lowest bucket, the most recent first. Every state is stored once in
+	 * an arena as its packed key, the index of its parent, the move leading
+	 * to it and its g- and h-values, 16 bytes in all. The closed set is an
+	 * open addressing table of indices into that arena.
+	 * States reached again with fewer moves are updated and queued again,
+	 * so heuristics only need to be admissible.
+	 */
+	class AStarSearch {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		AStarSearch(Map const& map, Goal const& goal, AStarOptions const& options = AStarOptions());
+
+		/**
+		 * Search for an optimal solution from the robot positions of the map
+		 * @return Shortest move sequence reaching the goal, if one is found within the limits
+		 */
+		std::optional<MoveSequence> solve();
+
+		/**
+		 * @return Number of states stored in the last search
+		 */
+		std::size_t getStoredStates() const {
+			return m_nodes.size();
+		}
+
+		/**
+		 * @return Number of states expanded in the last search
+		 */
+		std::size_t getExpandedStates() const {
+			return m_expanded;
+		}
+
+		/**
+		 * @return true iff the last search stopped at maxStates
+		 */
+		bool limitReached() const {
+			return m_limitReached;
+		}
+
+		/**
+		 * @return true iff the last search was interrupted
+		 */
+		bool interrupted() const {
+			return m_interrupted;
+		}
+
+		/**
+		 * Report the lower bounds on the moves to the goal that the last
+		 * search proved for its states. No solution through a state reached
+		 * with g moves is shorter than the optimal one, so at least that
+		 * length minus g moves remain from the state, or the depth limit
+		 * plus one minus g if there is no solution. The bounds hold for the
+		 * same goal from any start. Only states where they exceed the
+		 * heuristic are reported, and nothing after an incomplete or
+		 * weighted search.
+		 * @param visit Called with each state, its flags and its bound
+		 * @param limit Report at most this many, from the states stored first, which are closest to the start
+		 */
+		void learnedBounds(std::function<void(Map::State const&, GoalTest::flags_t, unsigned)> const& visit, std::size_t limit = SIZE_MAX) const;
+	private:
+		typedef std::uint64_t key_t;
+
+		static constexpr std::uint32_t NONE = UINT32_MAX;
+		static constexpr unsigned UNREACHABLE = UINT8_MAX;
+
+		struct Node {
+			key_t key;
+			std::uint32_t parent;
+			std::uint8_t move;
+			std::uint8_t g;
+			std::uint8_t h;
+		};
+
+		Map m_map;
+		GoalTest m_goalTest;
+		AStarOptions m_options;
+		Map::State m_start;
+		std::vector<Color> m_robots;
+		unsigned m_flagShift;
+		// Default heuristic
+		std::optional<GoalDistances> m_goalDistances;
+
+		std::vector<Node> m_nodes;
+		std::vector<std::uint32_t> m_table;
+		std::vector<std::vector<std::uint32_t>> m_buckets;
+		std::size_t m_expanded;
+		// Length of the solution of the last search, depthLimit + 1 if none
+		unsigned m_solutionLength;
+		bool m_limitReached;
+		bool m_interrupted;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		unsigned heuristic(Map::State const& state, GoalTest::flags_t flags) const;
+		std::uint32_t& slot(key_t k);
+		void grow();
+	};
+
+}
@@ -0,0 +1,56 @@
+#include "AnytimeSolver.h"
+
+namespace ricochet {
+
+	AnytimeSolver::AnytimeSolver(Map const& map, Goal const& goal, AnytimeOptions const& options) :
+			m_map(map), m_goal(goal), m_options(options), m_cancelled(false), m_optimal(false)
+	{
+	}
+
+	std::optional<MoveSequence> AnytimeSolver::solve() {
+		m_cancelled = false;
+		m_optimal = false;
+
+		AStarOptions search;
+		search.robots = m_options.robots;
+		search.maxStates = m_options.maxStates;
+		search.heuristic = m_options.heuristic;
+		search.interrupt = [this]() {
+			return m_cancelled || AnytimeOptions::clock_t::now() >= m_options.deadline;
+		};
+
+		std::optional<MoveSequence> best;
+		unsigned limit = m_options.depthLimit;
+		for (unsigned weight: m_options.weights) {
+			if (limit == 0u || search.interrupt()) {
+				break;
+			}
+			search.depthLimit = limit;
+			search.weight = weight;
+			AStarSearch astar(m_map, m_goal, search);
+			auto solution = astar.solve();
+			if (astar.interrupted()) {
+				break;
+			}
+			if (!solution) {
+				// Nothing shorter exists, unless the search gave up
+				m_optimal = !astar.limitReached();
+				if (m_optimal) {
+					break;
+				}
+				continue;
+			}
+			best = std::move(solution);
+			limit = static_cast<unsigned>(best->size()) - 1u;
+			if (m_options.onSolution) {
+				m_options.onSolution(*best);
+			}
+			if (weight == 1u) {
+				m_optimal = true;
+				break;
+			}
+		}
+		return best;
+	}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "AStarSearch.h"
+#include "Goal.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace ricochet {
+
+	struct AnytimeOptions {
+		typedef std::chrono::steady_clock clock_t;
+
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 30u;
+		/// Give up a search once it holds this many states, 0 for no limit
+		std::size_t maxStates = 0u;
+		/// Stop improving at this time
+		clock_t::time_point deadline = clock_t::time_point::max();
+		/// Weights of the heuristic for the searches in turn, the last one should be 1 to find an optimal solution
+		std::vector<unsigned> weights{ 5u, 3u, 2u, 1u };
+		/// Lower bound on the number of moves to the goal, see AStarOptions
+		std::function<unsigned(Map::State const&, GoalTest::flags_t)> heuristic;
+		/// Called with each solution shorter than all before, from the thread running solve()
+		std::function<void(MoveSequence const&)> onSolution;
+	};
+
+	/**
+	 * Solver for timed rounds: finds a solution quickly and keeps looking
+	 * for shorter ones until the deadline or cancel().
+	 * Runs A* searches with decreasing weights of the heuristic. The first,
+	 * strongly weighted search is close to greedy; each following one only
+	 * looks for solutions shorter than the best so far. A search that ends
+	 * without a solution, or the unweighted one, proves the best solution
+	 * optimal.
+	 */
+	class AnytimeSolver {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		AnytimeSolver(Map const& map, Goal const& goal, AnytimeOptions const& options = AnytimeOptions());
+
+		/**
+		 * Search until the deadline, cancel() or a proven optimal solution
+		 * @return Shortest move sequence found, if any
+		 */
+		std::optional<MoveSequence> solve();
+
+		/**
+		 * Stop the search running in solve(), may be called from any thread
+		 */
+		void cancel() {
+			m_cancelled = true;
+		}
+
+		/**
+		 * @return true iff the last search proved its solution optimal, or that there is none within depthLimit
+		 */
+		bool isOptimal() const {
+			return m_optimal;
+		}
+	private:
+		Map m_map;
+		Goal m_goal;
+		AnytimeOptions m_options;
+		std::atomic<bool> m_cancelled;
+		bool m_optimal;
+	};
+
+}
@@ -0,0 +1,260 @@
+#include "BddManager.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	namespace {
+		constexpr std::size_t INITIAL_TABLE_SIZE = 1u << 16u;
+		constexpr std::size_t MAX_CACHE_SIZE = 1u << 22u;
+	}
+
+	BddManager::BddManager(unsigned variables) : m_variables(variables) {
+		if (variables >= 64u) {
+			throw std::invalid_argument("BddManager: Too many variables");
+		}
+		// Constants are below all variables
+		m_nodes.push_back({ variables, ZERO, ZERO });
+		m_nodes.push_back({ variables, ONE, ONE });
+		m_unique.assign(INITIAL_TABLE_SIZE, EMPTY);
+		m_cache.assign(INITIAL_TABLE_SIZE, { Operation::AND, EMPTY, EMPTY, EMPTY });
+	}
+
+	std::size_t BddManager::hash(std::uint64_t a, std::uint64_t b, std::uint64_t c) {
+		std::uint64_t h = (a * 0x9E3779B97F4A7C15ull) ^ (b * 0xBF58476D1CE4E5B9ull) ^ (c * 0x94D049BB133111EBull);
+		return static_cast<std::size_t>(h ^ (h >> 31u));
+	}
+
+	BddManager::node_t BddManager::literal(unsigned var, bool value) {
+		return value ? make(var, ZERO, ONE) : make(var, ONE, ZERO);
+	}
+
+	BddManager::node_t BddManager::cube(unsigned var, unsigned bits, std::uint64_t value) {
+		node_t result = ONE;
+		for (unsigned i = 0u; i < bits; i++) {
+			// Bottom up, the least significant bit is the last variable
+			bool const bit = ((value >> i) & 1u) != 0u;
+			result = bit ? make(var + bits - 1u - i, ZERO, result) : make(var + bits - 1u - i, result, ZERO);
+		}
+		return result;
+	}
+
+	BddManager::node_t BddManager::make(std::uint32_t var, node_t low, node_t high) {
+		if (low == high) {
+			return low;
+		}
+		std::size_t const mask = m_unique.size() - 1u;
+		for (std::size_t i = hash(var, low, high) & mask;; i = (i + 1u) & mask) {
+			node_t const node = m_unique[i];
+			if (node == EMPTY) {
+				break;
+			}
+			Node const& n = m_nodes[node];
+			if (n.var == var && n.low == low && n.high == high) {
+				return node;
+			}
+		}
+		if (m_nodes.size() >= EMPTY - 1u) {
+			throw std::length_error("BddManager: Too many nodes");
+		}
+
+		node_t const node = static_cast<node_t>(m_nodes.size());
+		m_nodes.push_back({ var, low, high });
+		if (2u * m_nodes.size() > m_unique.size()) {
+			// Keep the load below one half
+			m_unique.assign(2u * m_unique.size(), EMPTY);
+			for (node_t n = 2u; n < m_nodes.size(); n++) {
+				insertUnique(n);
+			}
+			if (m_cache.size() < MAX_CACHE_SIZE) {
+				m_cache.assign(2u * m_cache.size(), { Operation::AND, EMPTY, EMPTY, EMPTY });
+			}
+		} else {
+			insertUnique(node);
+		}
+		return node;
+	}
+
+	void BddManager::insertUnique(node_t node) {
+		Node const& n = m_nodes[node];
+		std::size_t const mask = m_unique.size() - 1u;
+		std::size_t i = hash(n.var, n.low, n.high) & mask;
+		while (m_unique[i] != EMPTY) {
+			i = (i + 1u) & mask;
+		}
+		m_unique[i] = node;
+	}
+
+	BddManager::CacheEntry& BddManager::cacheSlot(Operation op, node_t a, node_t b) {
+		return m_cache[hash(static_cast<std::uint64_t>(op), a, b) & (m_cache.size() - 1u)];
+	}
+
+	BddManager::node_t BddManager::apply(Operation op, node_t a, node_t b) {
+		switch (op) {
+			case Operation::AND:
+				if (a == ZERO || b == ZERO) {
+					return ZERO;
+				}
+				if (a == ONE || a == b) {
+					return b;
+				}
+				if (b == ONE) {
+					return a;
+				}
+				if (a > b) {
+					std::swap(a, b);
+				}
+				break;
+			case Operation::OR:
+				if (a == ONE || b == ONE) {
+					return ONE;
+				}
+				if (a == ZERO || a == b) {
+					return b;
+				}
+				if (b == ZERO) {
+					return a;
+				}
+				if (a > b) {
+					std::swap(a, b);
+				}
+				break;
+			case Operation::AND_NOT:
+				if (a == ZERO || b == ONE || a == b) {
+					return ZERO;
+				}
+				if (b == ZERO) {
+					return a;
+				}
+				break;
+			case Operation::COFACTOR:
+				break;
+		}
+
+		{
+			CacheEntry const& entry = cacheSlot(op, a, b);
+			if (entry.op == op && entry.a == a && entry.b == b) {
+				return entry.result;
+			}
+		}
+
+		// Children may move when the recursion adds nodes, copy them
+		Node const na = m_nodes[a];
+		Node const nb = m_nodes[b];
+		std::uint32_t const var = std::min(na.var, nb.var);
+		node_t const low = apply(op, na.var == var ? na.low : a, nb.var == var ? nb.low : b);
+		node_t const high = apply(op, na.var == var ? na.high : a, nb.var == var ? nb.high : b);
+		node_t const result = make(var, low, high);
+		cacheSlot(op, a, b) = { op, a, b, result };
+		return result;
+	}
+
+	BddManager::node_t BddManager::cofactor(node_t f, node_t cube) {
+		// Skip the variables of the cube above the top of f
+		while (cube > ONE && m_nodes[cube].var < m_nodes[f].var) {
+			cube = m_nodes[cube].low == ZERO ? m_nodes[cube].high : m_nodes[cube].low;
+		}
+		if (f <= ONE || cube == ONE) {
+			return f;
+		}
+		{
+			CacheEntry const& entry = cacheSlot(Operation::COFACTOR, f, cube);
+			if (entry.op == Operation::COFACTOR && entry.a == f && entry.b == cube) {
+				return entry.result;
+			}
+		}
+
+		Node const nf = m_nodes[f];
+		Node const nc = m_nodes[cube];
+		node_t result;
+		if (nc.var == nf.var) {
+			result = nc.low == ZERO ? cofactor(nf.high, nc.high) : cofactor(nf.low, nc.low);
+		} else {
+			node_t const low = cofactor(nf.low, cube);
+			node_t const high = cofactor(nf.high, cube);
+			result = make(nf.var, low, high);
+		}
+		cacheSlot(Operation::COFACTOR, f, cube) = { Operation::COFACTOR, f, cube, result };
+		return result;
+	}
+
+	std::uint64_t BddManager::satCount(node_t f) const {
+		// Children have lower indices than their parents, count bottom up.
+		// counts[n] are the assignments to the variables from the one of n.
+		std::vector<std::uint64_t> counts(std::max<std::size_t>(f + 1u, 2u), 0u);
+		counts[ONE] = 1u;
+		auto below = [&](std::uint32_t var, node_t child) {
+			return counts[child] << (m_nodes[child].var - var - 1u);
+		};
+		for (node_t n = 2u; n <= f; n++) {
+			Node const& node = m_nodes[n];
+			counts[n] = below(node.var, node.low) + below(node.var, node.high);
+		}
+		return counts[f] << m_nodes[f].var;
+	}
+
+	std::size_t BddManager::nodeCount(node_t f) const {
+		std::vector<bool> reached(std::max<std::size_t>(f + 1u, 2u), false);
+		reached[f] = true;
+		std::size_t count = 0u;
+		for (std::size_t n = f; n > ONE; n--) {
+			if (reached[n]) {
+				count++;
+				reached[m_nodes[n].low] = true;
+				reached[m_nodes[n].high] = true;
+			}
+		}
+		return count;
+	}
+
+	void BddManager::collectGarbage(std::vector<node_t>& roots) {
+		std::vector<bool> live(m_nodes.size(), false);
+		live[ZERO] = true;
+		live[ONE] = true;
+		for (node_t const root: roots) {
+			live[root] = true;
+		}
+		// Parents come after their children, so one pass from the top marks all
+		for (std::size_t n = m_nodes.size(); n-- > 2u;) {
+			if (live[n]) {
+				live[m_nodes[n].low] = true;
+				live[m_nodes[n].high] = true;
+			}
+		}
+
+		std::vector<node_t> renumber(m_nodes.size(), EMPTY);
+		std::size_t kept = 0u;
+		for (std::size_t n = 0u; n < m_nodes.size(); n++) {
+			if (!live[n]) {
+				continue;
+			}
+			Node node = m_nodes[n];
+			if (n > ONE) {
+				node.low = renumber[node.low];
+				node.high = renumber[node.high];
+			}
+			renumber[n] = static_cast<node_t>(kept);
+			m_nodes[kept++] = node;
+		}
+		m_nodes.resize(kept);
+		for (node_t& root: roots) {
+			root = renumber[root];
+		}
+
+		// Shrink the tables to a load of one quarter
+		std::size_t size = INITIAL_TABLE_SIZE;
+		while (size < 4u * m_nodes.size()) {
+			size *= 2u;
+		}
+		m_unique.assign(size, EMPTY);
+		m_unique.shrink_to_fit();
+		for (node_t n = 2u; n < m_nodes.size(); n++) {
+			insertUnique(n);
+		}
+		// The cache keeps its size, it is what makes repeated images fast
+		std::fill(m_cache.begin(), m_cache.end(), CacheEntry{ Operation::AND, EMPTY, EMPTY, EMPTY });
+		m_nodes.shrink_to_fit();
+	}
+
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Minimal package for reduced ordered binary decision diagrams. Nodes
+	 * are identified by index and shared through a unique table, so equal
+	 * functions always have the same index. Variables are ordered by
+	 * number, 0 at the top. Results of operations are memoized in a direct
+	 * mapped cache. Nodes are never freed by operations; collectGarbage()
+	 * keeps only what is reachable from the given roots.
+	 */
+	class BddManager {
+	public:
+		typedef std::uint32_t node_t;
+
+		/// Constant functions
+		static constexpr node_t ZERO = 0u;
+		static constexpr node_t ONE = 1u;
+
+		/**
+		 * @param variables Number of variables, at most 63 for satCount() to be exact
+		 */
+		explicit BddManager(unsigned variables);
+
+		/**
+		 * @param var Variable number
+		 * @param value Polarity
+		 * @return Function that is true iff the variable has the value
+		 */
+		node_t literal(unsigned var, bool value);
+
+		/**
+		 * @param var First of the variables, most significant bit
+		 * @param bits Number of consecutive variables
+		 * @param value Number to encode
+		 * @return Function that is true iff the variables encode the value
+		 */
+		node_t cube(unsigned var, unsigned bits, std::uint64_t value);
+
+		node_t conjunction(node_t a, node_t b) {
+			return apply(Operation::AND, a, b);
+		}
+
+		node_t disjunction(node_t a, node_t b) {
+			return apply(Operation::OR, a, b);
+		}
+
+		/**
+		 * @return Function that is true iff a is true and b is false
+		 */
+		node_t difference(node_t a, node_t b) {
+			return apply(Operation::AND_NOT, a, b);
+		}
+
+		/**
+		 * Fix the variables of a cube to its values
+		 * @param f Function
+		 * @param cube Conjunction of literals
+		 * @return Cofactor of f, not depending on the variables of the cube
+		 */
+		node_t cofactor(node_t f, node_t cube);
+
+		/**
+		 * @param f Function
+		 * @return Number of assignments to all variables for which f is true
+		 */
+		std::uint64_t satCount(node_t f) const;
+
+		/**
+		 * @param f Function
+		 * @return Number of nodes of the diagram of f, without the constants
+		 */
+		std::size_t nodeCount(node_t f) const;
+
+		/**
+		 * Free all nodes not reachable from the roots. Node indices change,
+		 * the roots are updated in place, any other index becomes invalid.
+		 * @param roots Functions to keep
+		 */
+		void collectGarbage(std::vector<node_t>& roots);
+
+		/**
+		 * @return Number of nodes, including both constants
+		 */
+		std::size_t getNodeCount() const {
+			return m_nodes.size();
+		}
+
+		/**
+		 * @return Bytes held by nodes, unique table and cache
+		 */
+		std::size_t getMemoryUsage() const {
+			return m_nodes.capacity() * sizeof(Node) + m_unique.capacity() * sizeof(node_t) + m_cache.capacity() * sizeof(CacheEntry);
+		}
+	private:
+		enum class Operation : std::uint32_t {
+			AND, OR, AND_NOT, COFACTOR
+		};
+
+		static constexpr node_t EMPTY = UINT32_MAX;
+
+		struct Node {
+			std::uint32_t var;
+			node_t low;
+			node_t high;
+		};
+
+		struct CacheEntry {
+			Operation op;
+			node_t a;
+			node_t b;
+			node_t result;
+		};
+
+		unsigned m_variables;
+		std::vector<Node> m_nodes;
+		// Open addressing, indices of nodes or EMPTY
+		std::vector<node_t> m_unique;
+		std::vector<CacheEntry> m_cache;
+
+		static std::size_t hash(std::uint64_t a, std::uint64_t b, std::uint64_t c);
+
+		node_t make(std::uint32_t var, node_t low, node_t high);
+		void insertUnique(node_t node);
+		node_t apply(Operation op, node_t a, node_t b);
+		CacheEntry& cacheSlot(Operation op, node_t a, node_t b);
+	};
+
+}
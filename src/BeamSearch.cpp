@@ -0,0 +1,118 @@
+#include "BeamSearch.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	BeamSearch::BeamSearch(Map const& map, Goal const& goal, BeamOptions const& options) :
+			m_map(map), m_goalTest(goal), m_options(options), m_start(map.state()),
+			m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()), m_lowerBound(0u), m_gap(0u)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("BeamSearch: Board too large");
+		}
+		if (m_options.width == 0u) {
+			throw std::invalid_argument("BeamSearch: Width must be positive");
+		}
+		for (auto c: RobotColors) {
+			if (!map.posValid(map.getRobotPos(c))) {
+				continue;
+			}
+			if (m_options.robots.empty() || std::find(m_options.robots.cbegin(), m_options.robots.cend(), c) != m_options.robots.cend()) {
+				m_robots.push_back(c);
+			}
+		}
+		if (!m_options.heuristic) {
+			m_goalDistances.emplace(map, goal, m_robots);
+		}
+	}
+
+	unsigned BeamSearch::heuristic(Map::State const& state, GoalTest::flags_t flags) const {
+		if (m_options.heuristic) {
+			return m_options.heuristic(state, flags);
+		}
+		return m_goalDistances->lowerBound(state);
+	}
+
+	std::optional<MoveSequence> BeamSearch::solve() {
+		m_nodes.clear();
+		m_seen.clear();
+		m_gap = 0u;
+		m_lowerBound = heuristic(m_start, 0u);
+		if (m_lowerBound >= GoalDistances::UNREACHABLE) {
+			return std::nullopt;
+		}
+
+		m_nodes.push_back({ key(m_start, 0u), NONE, 0u });
+		m_seen.insert(m_nodes.back().key);
+		std::vector<std::uint32_t> layer{ 0u };
+		std::vector<Candidate> candidates;
+		for (unsigned depth = 1u; depth <= m_options.depthLimit && !layer.empty(); depth++) {
+			// All successors of the layer
+			candidates.clear();
+			for (std::uint32_t const index: layer) {
+				key_t const k = m_nodes[index].key;
+				Map::State const state = m_map.unpack(k & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+				GoalTest::flags_t const flags = static_cast<GoalTest::flags_t>(k >> m_flagShift);
+				for (auto c: m_robots) {
+					for (auto requested: AllDirections) {
+						m_map.loadState(state);
+						Direction dir = requested;
+						if (!m_map.moveRobot(c, dir)) {
+							continue;
+						}
+						std::uint8_t const move = encodeMove({ c, requested });
+						if (m_goalTest.finishes(m_map, c, requested, flags)) {
+							m_gap = depth - std::min(depth, m_lowerBound);
+							return buildSolution(index, move);
+						}
+						GoalTest::flags_t const childFlags = m_goalTest.update(flags, c, dir);
+						key_t const childKey = key(m_map.state(), childFlags);
+						if (m_seen.find(childKey) != m_seen.cend()) {
+							continue;
+						}
+						unsigned const h = heuristic(m_map.state(), childFlags);
+						if (h < GoalDistances::UNREACHABLE) {
+							// Mix the key to break ties without favouring any robot
+							candidates.push_back({ { childKey, index, move }, h, (childKey ^ (childKey >> 29u)) * 0xBF58476D1CE4E5B9ull });
+						}
+					}
+				}
+			}
+
+			// Keep the best, remembering only those
+			std::sort(candidates.begin(), candidates.end(), [](Candidate const& a, Candidate const& b) {
+				return a.node.key < b.node.key;
+			});
+			candidates.erase(std::unique(candidates.begin(), candidates.end(), [](Candidate const& a, Candidate const& b) {
+				return a.node.key == b.node.key;
+			}), candidates.end());
+			if (candidates.size() > m_options.width) {
+				auto const end = candidates.begin() + static_cast<std::ptrdiff_t>(m_options.width);
+				std::nth_element(candidates.begin(), end, candidates.end(), [](Candidate const& a, Candidate const& b) {
+					return a.h != b.h ? a.h < b.h : a.tieBreak < b.tieBreak;
+				});
+				candidates.erase(end, candidates.end());
+			}
+			layer.clear();
+			for (auto const& candidate: candidates) {
+				layer.push_back(static_cast<std::uint32_t>(m_nodes.size()));
+				m_nodes.push_back(candidate.node);
+				m_seen.insert(candidate.node.key);
+			}
+		}
+		return std::nullopt;
+	}
+
+	MoveSequence BeamSearch::buildSolution(std::uint32_t parent, std::uint8_t move) const {
+		MoveSequence moves;
+		moves.push_back(decodeMove(move));
+		for (std::uint32_t i = parent; m_nodes[i].parent != NONE; i = m_nodes[i].parent) {
+			moves.push_back(decodeMove(m_nodes[i].move));
+		}
+		std::reverse(moves.begin(), moves.end());
+		return moves;
+	}
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalDistances.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace ricochet {
+
+	struct BeamOptions {
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Number of states kept per depth
+		std::size_t width = 10000u;
+		/// Longest solution searched for
+		unsigned depthLimit = 60u;
+		/**
+		 * Estimate of the number of moves to the goal, lower is better,
+		 * GoalDistances::UNREACHABLE or more drops the state. If empty,
+		 * GoalDistances is used. Only an admissible heuristic gives a
+		 * meaningful lower bound.
+		 */
+		std::function<unsigned(Map::State const&, GoalTest::flags_t)> heuristic;
+	};
+
+	/**
+	 * Solver for long puzzles that gives up optimality for bounded time
+	 * and memory. Expands a breadth first search one depth at a time,
+	 * generating all successors of the kept states at once and keeping the
+	 * width best by heuristic. Only the kept states are remembered, at most
+	 * width per depth, so memory grows with width times depth; they are
+	 * never revisited, while a state cut at one depth may be generated
+	 * again later. The first solution found is returned.
+	 */
+	class BeamSearch {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		BeamSearch(Map const& map, Goal const& goal, BeamOptions const& options = BeamOptions());
+
+		/**
+		 * Search for a solution from the robot positions of the map
+		 * @return A move sequence reaching the goal, if one is found within depthLimit
+		 */
+		std::optional<MoveSequence> solve();
+
+		/**
+		 * @return Lower bound on the length of an optimal solution, from the heuristic of the start
+		 */
+		unsigned getLowerBound() const {
+			return m_lowerBound;
+		}
+
+		/**
+		 * @return Moves by which the last solution may exceed an optimal one
+		 */
+		unsigned getGap() const {
+			return m_gap;
+		}
+
+		/**
+		 * @return Number of states kept in the last search
+		 */
+		std::size_t getStoredStates() const {
+			return m_nodes.size();
+		}
+	private:
+		typedef std::uint64_t key_t;
+
+		static constexpr std::uint32_t NONE = UINT32_MAX;
+
+		struct Node {
+			key_t key;
+			std::uint32_t parent;
+			std::uint8_t move;
+		};
+
+		struct Candidate {
+			Node node;
+			unsigned h;
+			std::uint64_t tieBreak;
+		};
+
+		Map m_map;
+		GoalTest m_goalTest;
+		BeamOptions m_options;
+		Map::State m_start;
+		std::vector<Color> m_robots;
+		unsigned m_flagShift;
+		std::optional<GoalDistances> m_goalDistances;
+
+		std::vector<Node> m_nodes;
+		std::unordered_set<key_t> m_seen;
+		unsigned m_lowerBound;
+		unsigned m_gap;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		unsigned heuristic(Map::State const& state, GoalTest::flags_t flags) const;
+		MoveSequence buildSolution(std::uint32_t parent, std::uint8_t move) const;
+	};
+
+}
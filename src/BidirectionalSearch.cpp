@@ -0,0 +1,246 @@
+#include "BidirectionalSearch.h"
+#include "RobotRelevance.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace ricochet {
+
+	BidirectionalSearch::BidirectionalSearch(Map const& map, Goal const& goal, BidirectionalOptions const& options) :
+			m_map(map), m_goalTest(goal), m_options(options), m_start(map.state()), m_flagMask(0u),
+			m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()),
+			m_best(std::numeric_limits<unsigned>::max()), m_limitReached(false), m_interrupted(false), m_polls(0u)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("BidirectionalSearch: Board too large");
+		}
+		if (m_options.depthLimit > std::numeric_limits<std::uint8_t>::max()) {
+			throw std::invalid_argument("BidirectionalSearch: Depth limit too large");
+		}
+		for (auto c: RobotColors) {
+			if (!map.posValid(map.getRobotPos(c))) {
+				continue;
+			}
+			if (m_options.robots.empty() || std::find(m_options.robots.cbegin(), m_options.robots.cend(), c) != m_options.robots.cend()) {
+				m_robots.push_back(c);
+			}
+		}
+		if (m_options.pruneRobots && !m_robots.empty()) {
+			m_robots = RobotRelevance(map, goal, m_robots).relevantRobots(m_options.depthLimit);
+		}
+		for (auto c: m_robots) {
+			m_flagMask = static_cast<GoalTest::flags_t>(m_flagMask | m_goalTest.update(0u, c, Direction::NORTH) | m_goalTest.update(0u, c, Direction::EAST));
+		}
+	}
+
+	std::optional<MoveSequence> BidirectionalSearch::solve() {
+		m_forward.clear();
+		m_backward.clear();
+		m_meet.reset();
+		m_best = std::numeric_limits<unsigned>::max();
+		m_limitReached = false;
+		m_interrupted = false;
+
+		seedBackward();
+		add(m_forward, m_backward, key(m_start, 0u), NONE, 0u, 0u);
+		if (overLimit() || m_interrupted) {
+			return std::nullopt;
+		}
+
+		unsigned forwardDepth = 0u;
+		unsigned backwardDepth = 1u;
+		while (!m_meet && forwardDepth + backwardDepth < m_options.depthLimit) {
+			if (m_forward.frontier.empty() || m_backward.frontier.empty()) {
+				break;
+			}
+			if (m_forward.frontier.size() <= m_backward.frontier.size()) {
+				expandForward(++forwardDepth);
+			} else {
+				expandBackward(++backwardDepth);
+			}
+			if (overLimit() || m_interrupted) {
+				return std::nullopt;
+			}
+		}
+
+		if (!m_meet) {
+			return std::nullopt;
+		}
+		return buildSolution();
+	}
+
+	void BidirectionalSearch::add(Side& side, Side const& other, key_t k, index_t link, std::uint8_t move, unsigned depth) {
+		side.keys.push_back(k);
+		auto const inserted = side.index.insert(side.keys.size() - 1u);
+		if (!inserted.second) {
+			side.keys.pop_back();
+			return;
+		}
+		side.links.push_back(link);
+		side.moves.push_back(move);
+		side.depths.push_back(static_cast<std::uint8_t>(depth));
+		side.frontier.push_back(inserted.first);
+		auto const met = other.index.find(k);
+		if (met && depth + other.depths[*met] < m_best) {
+			m_best = depth + other.depths[*met];
+			m_meet = k;
+		}
+	}
+
+	void BidirectionalSearch::seedBackward() {
+		Goal const& goal = m_goalTest.getGoal();
+		std::vector<Map::Predecessor> predecessors;
+		std::size_t const cells = m_map.getWidth() * m_map.getHeight();
+
+		for (auto g: m_robots) {
+			if (!m_goalTest.isGoalRobot(g)) {
+				continue;
+			}
+			// Robots that are not movable keep their start positions
+			Map::State target = m_start;
+			std::vector<Color> others;
+			for (auto c: m_robots) {
+				target.robots[toInt(c)] = Pos();
+				if (c != g) {
+					others.push_back(c);
+				}
+			}
+			auto isFree = [&](Pos const& pos) {
+				TileType const tile = m_map.getTileType(pos);
+				if (tile != TileType::EMPTY && tile != TileType::GOAL) {
+					return false;
+				}
+				return std::none_of(RobotColors.cbegin(), RobotColors.cend(), [&](Color c) { return target.robots[toInt(c)] == pos; });
+			};
+			if (!isFree(goal.pos)) {
+				continue;
+			}
+			target.robots[toInt(g)] = goal.pos;
+
+			// Place the other movable robots on all combinations of free cells
+			// and add the predecessors that complete the goal
+			std::function<void(std::size_t)> place = [&](std::size_t i) {
+				if (m_interrupted || m_limitReached) {
+					return;
+				}
+				if (i < others.size()) {
+					for (std::size_t cell = 0u; cell < cells; cell++) {
+						Pos const pos = m_map.getCellPos(cell);
+						if (isFree(pos)) {
+							target.robots[toInt(others[i])] = pos;
+							place(i + 1u);
+							target.robots[toInt(others[i])] = Pos();
+						}
+					}
+					return;
+				}
+				if (poll() || overLimit()) {
+					return;
+				}
+
+				target.hash = m_map.computeHash(target.robots);
+				m_map.loadState(target);
+				m_map.getPredecessors(g, predecessors);
+				for (auto const& p: predecessors) {
+					Map::State previous = target;
+					previous.robots[toInt(g)] = p.pos;
+					for (GoalTest::flags_t flags = m_flagMask;; flags = static_cast<GoalTest::flags_t>((flags - 1u) & m_flagMask)) {
+						if (m_goalTest.finishes(m_map, g, p.requested, flags)) {
+							add(m_backward, m_forward, key(previous, flags), NONE, encodeMove({ g, p.requested }), 1u);
+						}
+						if (flags == 0u) {
+							break;
+						}
+					}
+				}
+			};
+			place(0u);
+		}
+	}
+
+	void BidirectionalSearch::expandForward(unsigned depth) {
+		std::vector<index_t> layer;
+		layer.swap(m_forward.frontier);
+		for (index_t const index: layer) {
+			if (poll()) {
+				return;
+			}
+			key_t const k = m_forward.keys[index];
+			Map::State const state = stateOf(k);
+			GoalTest::flags_t const flags = flagsOf(k);
+			for (auto c: m_robots) {
+				for (auto requested: AllDirections) {
+					m_map.loadState(state);
+					Direction dir = requested;
+					if (!m_map.moveRobot(c, dir)) {
+						continue;
+					}
+					if (m_goalTest.finishes(m_map, c, requested, flags)) {
+						// Ends the round, covered by the goal side
+						continue;
+					}
+					add(m_forward, m_backward, key(m_map.state(), m_goalTest.update(flags, c, dir)), index, encodeMove({ c, requested }), depth);
+				}
+			}
+		}
+	}
+
+	void BidirectionalSearch::expandBackward(unsigned depth) {
+		std::vector<index_t> layer;
+		layer.swap(m_backward.frontier);
+		std::vector<Map::Predecessor> predecessors;
+		std::array<GoalTest::flags_t, 2> previousFlags;
+		for (index_t const index: layer) {
+			if (poll()) {
+				return;
+			}
+			key_t const k = m_backward.keys[index];
+			Map::State const state = stateOf(k);
+			GoalTest::flags_t const flags = flagsOf(k);
+			m_map.loadState(state);
+			for (auto c: m_robots) {
+				m_map.getPredecessors(c, predecessors);
+				for (auto const& p: predecessors) {
+					Map::State previous = state;
+					previous.robots[toInt(c)] = p.pos;
+					unsigned const n = m_goalTest.previous(flags, c, p.final, previousFlags);
+					for (unsigned i = 0u; i < n; i++) {
+						add(m_backward, m_forward, key(previous, previousFlags[i]), index, encodeMove({ c, p.requested }), depth);
+					}
+				}
+			}
+		}
+	}
+
+	bool BidirectionalSearch::overLimit() {
+		if (m_options.maxStates != 0u && m_forward.keys.size() + m_backward.keys.size() > m_options.maxStates) {
+			m_limitReached = true;
+		}
+		return m_limitReached;
+	}
+
+	bool BidirectionalSearch::poll() {
+		if (!m_interrupted && (++m_polls & 0xFFu) == 0u && m_options.interrupt && m_options.interrupt()) {
+			m_interrupted = true;
+		}
+		return m_interrupted;
+	}
+
+	MoveSequence BidirectionalSearch::buildSolution() const {
+		MoveSequence moves;
+		// From the meeting state back to the start
+		for (index_t i = *m_forward.index.find(*m_meet); m_forward.links[i] != NONE; i = m_forward.links[i]) {
+			moves.push_back(decodeMove(m_forward.moves[i]));
+		}
+		std::reverse(moves.begin(), moves.end());
+
+		// And on to the goal
+		for (index_t i = *m_backward.index.find(*m_meet); i != NONE; i = m_backward.links[i]) {
+			moves.push_back(decodeMove(m_backward.moves[i]));
+		}
+		return moves;
+	}
+
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+#include "StateIndex.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace ricochet {
+
+	struct BidirectionalOptions {
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Longest solution searched for
+		unsigned depthLimit = 20u;
+		/// Give up once both searches together hold this many states, 0 for no limit. The goal side is seeded within it as well.
+		std::size_t maxStates = std::size_t(1u) << 22u;
+		/// Polled during the search, which gives up once it returns true
+		std::function<bool()> interrupt;
+		/// Leave robots where they are that can not affect the goal robots within depthLimit moves, see RobotRelevance
+		bool pruneRobots = true;
+	};
+
+	/**
+	 * Optimal solver searching from the start and from the goal at the same
+	 * time until the two searches meet.
+	 * The goal side starts with all states from which one move completes
+	 * the goal: the goal robot is put on the target, every other movable
+	 * robot on every free cell, and the predecessors of these states are
+	 * generated. That set grows with the number of cells to the power of
+	 * the number of other movable robots, so the search pays off with few
+	 * movable robots. Robots that can not matter within depthLimit moves
+	 * are left where they are, and maxStates bounds the seeding as well
+	 * as the search; with many robots that matter, restrict the robots
+	 * that may move.
+	 * Each step expands the full layer of the smaller frontier and checks
+	 * new states against the other side, so both only go about half way.
+	 * Each side keeps its states in arrays in the order they were reached,
+	 * indexed by a StateIndex, with the link to the next state towards its
+	 * root as an array index.
+	 */
+	class BidirectionalSearch {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		BidirectionalSearch(Map const& map, Goal const& goal, BidirectionalOptions const& options = BidirectionalOptions());
+
+		BidirectionalSearch(BidirectionalSearch const&) = delete;
+		BidirectionalSearch& operator=(BidirectionalSearch const&) = delete;
+
+		/**
+		 * Search for an optimal solution from the robot positions of the map
+		 * @return Shortest move sequence reaching the goal, if one is found within the limits
+		 */
+		std::optional<MoveSequence> solve();
+
+		/**
+		 * @return Number of states reached from the start in the last search
+		 */
+		std::size_t getForwardStates() const {
+			return m_forward.keys.size();
+		}
+
+		/**
+		 * @return Number of states reached from the goal in the last search
+		 */
+		std::size_t getBackwardStates() const {
+			return m_backward.keys.size();
+		}
+
+		/**
+		 * @return true iff the last search stopped at maxStates
+		 */
+		bool limitReached() const {
+			return m_limitReached;
+		}
+
+		/**
+		 * @return true iff the last search was interrupted
+		 */
+		bool interrupted() const {
+			return m_interrupted;
+		}
+	private:
+		typedef std::uint64_t key_t;
+		typedef StateIndex::index_t index_t;
+
+		static constexpr index_t NONE = UINT32_MAX;
+
+		// States reached by one of the searches
+		struct Side {
+			std::vector<key_t> keys;
+			// Parent for forward states, successor for backward states, NONE for the roots
+			std::vector<index_t> links;
+			std::vector<std::uint8_t> moves;
+			std::vector<std::uint8_t> depths;
+			StateIndex index;
+			// States of the last layer
+			std::vector<index_t> frontier;
+
+			Side() : index(keys) {
+				//
+			}
+
+			void clear() {
+				keys.clear();
+				links.clear();
+				moves.clear();
+				depths.clear();
+				index.clear();
+				frontier.clear();
+			}
+		};
+
+		Map m_map;
+		GoalTest m_goalTest;
+		BidirectionalOptions m_options;
+		Map::State m_start;
+		std::vector<Color> m_robots;
+		// Flags that can be set by the movable robots
+		GoalTest::flags_t m_flagMask;
+		unsigned m_flagShift;
+
+		Side m_forward;
+		Side m_backward;
+		std::optional<key_t> m_meet;
+		unsigned m_best;
+		bool m_limitReached;
+		bool m_interrupted;
+		std::size_t m_polls;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		GoalTest::flags_t flagsOf(key_t k) const {
+			return static_cast<GoalTest::flags_t>(k >> m_flagShift);
+		}
+
+		Map::State stateOf(key_t k) const {
+			return m_map.unpack(k & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+		}
+
+		// Add a state to a side unless it is known, and check the other side for it
+		void add(Side& side, Side const& other, key_t k, index_t link, std::uint8_t move, unsigned depth);
+		void seedBackward();
+		void expandForward(unsigned depth);
+		void expandBackward(unsigned depth);
+		bool overLimit();
+		bool poll();
+		MoveSequence buildSolution() const;
+	};
+
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Writes a binary file of fixed size values through a temporary file,
+	 * which replaces the target only on commit(). A crash while writing
+	 * leaves the previous version of the file intact.
+	 */
+	class BinaryWriter {
+	public:
+		explicit BinaryWriter(std::string const& fileName) : m_fileName(fileName), m_tmpName(fileName + ".tmp"), m_out(m_tmpName, std::ios::binary | std::ios::trunc) {
+			if (!m_out) {
+				throw std::runtime_error("BinaryWriter: Could not open " + m_tmpName);
+			}
+		}
+
+		template<typename T>
+		void put(T const& value) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+			m_out.write(reinterpret_cast<char const*>(&value), sizeof(T));
+		}
+
+		/**
+		 * Write an array of values without a size
+		 */
+		template<typename T>
+		void putArray(T const* values, std::size_t count) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+			m_out.write(reinterpret_cast<char const*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+		}
+
+		/**
+		 * Write the size of a vector followed by its elements
+		 */
+		template<typename T>
+		void putVector(std::vector<T> const& values) {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+			put<std::uint64_t>(values.size());
+			m_out.write(reinterpret_cast<char const*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+		}
+
+		/**
+		 * Finish writing and replace the target file
+		 */
+		void commit() {
+			m_out.close();
+			if (!m_out) {
+				throw std::runtime_error("BinaryWriter: Could not write " + m_tmpName);
+			}
+			std::filesystem::rename(m_tmpName, m_fileName);
+		}
+	private:
+		std::string const m_fileName;
+		std::string const m_tmpName;
+		std::ofstream m_out;
+	};
+
+	/**
+	 * Reads a binary file written by BinaryWriter
+	 */
+	class BinaryReader {
+	public:
+		explicit BinaryReader(std::string const& fileName) : m_in(fileName, std::ios::binary) {
+			if (!m_in) {
+				throw std::runtime_error("BinaryReader: Could not open " + fileName);
+			}
+		}
+
+		template<typename T>
+		T get() {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+			T value;
+			m_in.read(reinterpret_cast<char*>(&value), sizeof(T));
+			check();
+			return value;
+		}
+
+		template<typename T>
+		std::vector<T> getVector() {
+			static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+			std::vector<T> values(get<std::uint64_t>());
+			m_in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+			check();
+			return values;
+		}
+	private:
+		std::ifstream m_in;
+
+		void check() {
+			if (!m_in) {
+				throw std::runtime_error("BinaryReader: Truncated file");
+			}
+		}
+	};
+
+}
@@ -0,0 +1,109 @@
+#include "DistanceMatrix.h"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+
+namespace ricochet {
+
+	DistanceMatrix::DistanceMatrix(Map const& map, unsigned threads) : m_map(map), m_cells(map.getWidth() * map.getHeight()) {
+		// Colors of barriers need their own matrix, all others share the first
+		std::vector<Color> barrierColors;
+		for (std::size_t cell = 0u; cell < m_cells; cell++) {
+			Pos const pos = map.getCellPos(cell);
+			if (map.getTileType(pos) == TileType::BARRIER) {
+				Color const c = map.getBarrier(pos).color;
+				if (std::find(barrierColors.cbegin(), barrierColors.cend(), c) == barrierColors.cend()) {
+					barrierColors.push_back(c);
+				}
+			}
+		}
+
+		std::optional<std::size_t> shared;
+		for (auto c: RobotColors) {
+			bool const own = std::find(barrierColors.cbegin(), barrierColors.cend(), c) != barrierColors.cend();
+			if (!own && shared) {
+				m_matrixOf[toInt(c) - 1u] = *shared;
+				continue;
+			}
+			m_matrices.emplace_back(m_cells * m_cells, UNREACHABLE);
+			build(c, m_matrices.back(), threads);
+			m_matrixOf[toInt(c) - 1u] = m_matrices.size() - 1u;
+			if (!own) {
+				shared = m_matrices.size() - 1u;
+			}
+		}
+	}
+
+	void DistanceMatrix::build(Color c, std::vector<std::uint8_t>& matrix, unsigned threads) const {
+		// Stop cell of every move of the lone robot
+		std::size_t const none = m_cells;
+		std::vector<std::size_t> stops(m_cells * AllDirections.size(), none);
+		Map local = m_map;
+		Map::State empty = m_map.state();
+		for (auto r: RobotColors) {
+			empty.robots[toInt(r)] = Pos();
+		}
+		for (std::size_t cell = 0u; cell < m_cells; cell++) {
+			Pos const pos = m_map.getCellPos(cell);
+			TileType const tile = m_map.getTileType(pos);
+			if (tile != TileType::EMPTY && tile != TileType::GOAL) {
+				continue;
+			}
+			for (std::size_t d = 0u; d < AllDirections.size(); d++) {
+				Map::State state = empty;
+				state.robots[toInt(c)] = pos;
+				local.loadState(state);
+				Direction dir = AllDirections[d];
+				if (local.moveRobot(c, dir)) {
+					stops[cell * AllDirections.size() + d] = local.getCellIndex(local.state().robots[toInt(c)]);
+				}
+			}
+		}
+
+		threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(m_cells)));
+		auto worker = [&](unsigned t) {
+			std::vector<std::size_t> queue;
+			queue.reserve(m_cells);
+			for (std::size_t source = m_cells * t / threads; source < m_cells * (t + 1u) / threads; source++) {
+				TileType const tile = m_map.getTileType(m_map.getCellPos(source));
+				if (tile != TileType::EMPTY && tile != TileType::GOAL) {
+					continue;
+				}
+				std::uint8_t* row = matrix.data() + source * m_cells;
+				row[source] = 0u;
+				queue.clear();
+				queue.push_back(source);
+				for (std::size_t head = 0u; head < queue.size(); head++) {
+					std::size_t const cell = queue[head];
+					std::uint8_t const next = static_cast<std::uint8_t>(std::min<unsigned>(row[cell] + 1u, UNREACHABLE - 1u));
+					for (std::size_t d = 0u; d < AllDirections.size(); d++) {
+						std::size_t const stop = stops[cell * AllDirections.size() + d];
+						if (stop != none && row[stop] == UNREACHABLE) {
+							row[stop] = next;
+							queue.push_back(stop);
+						}
+					}
+				}
+			}
+		};
+
+		std::vector<std::thread> pool;
+		for (unsigned t = 1u; t < threads; t++) {
+			pool.emplace_back(worker, t);
+		}
+		worker(0u);
+		for (auto& thread: pool) {
+			thread.join();
+		}
+	}
+
+	std::size_t DistanceMatrix::getMemoryUsage() const {
+		std::size_t bytes = 0u;
+		for (auto const& matrix: m_matrices) {
+			bytes += matrix.capacity();
+		}
+		return bytes;
+	}
+
+}
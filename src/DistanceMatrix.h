@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Color.h"
+#include "Map.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Minimum number of moves for a lone robot between any two cells of a
+	 * board, with all other robots removed. Ricochets are not required.
+	 * Only coloured barriers make the robot color matter, so robots that
+	 * are not the color of any barrier share one matrix.
+	 * Entries are single bytes, rows indexed by the start cell.
+	 */
+	class DistanceMatrix {
+	public:
+		/// Marks cells that can not be reached
+		static constexpr std::uint8_t UNREACHABLE = std::numeric_limits<std::uint8_t>::max();
+
+		/**
+		 * Build the matrices with one breadth first search per start cell
+		 * @param map Board, robot positions are ignored
+		 * @param threads Number of threads sharing the start cells
+		 */
+		explicit DistanceMatrix(Map const& map, unsigned threads = 1u);
+
+		/**
+		 * @param c Robot color
+		 * @param from Start cell
+		 * @param to Target cell
+		 * @return Number of moves, or UNREACHABLE
+		 */
+		std::uint8_t distance(Color c, Pos const& from, Pos const& to) const {
+			return m_matrices[m_matrixOf[toInt(c) - 1u]][m_map.getCellIndex(from) * m_cells + m_map.getCellIndex(to)];
+		}
+
+		/**
+		 * @param c Robot color
+		 * @param from Start cell
+		 * @return Row of the distances to all cells, indexed by cell
+		 */
+		std::uint8_t const* row(Color c, Pos const& from) const {
+			return m_matrices[m_matrixOf[toInt(c) - 1u]].data() + m_map.getCellIndex(from) * m_cells;
+		}
+
+		/**
+		 * @return Memory held by the matrices in bytes
+		 */
+		std::size_t getMemoryUsage() const;
+	private:
+		Map m_map;
+		std::size_t m_cells;
+		std::vector<std::vector<std::uint8_t>> m_matrices;
+		std::array<std::size_t, RICOCHET_ROBOTS_MAX_ROBOT_COUNT> m_matrixOf;
+
+		void build(Color c, std::vector<std::uint8_t>& matrix, unsigned threads) const;
+	};
+
+}
@@ -0,0 +1,308 @@
+#include "EndgameTable.h"
+#include "BinaryFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ricochet {
+
+	namespace {
+		constexpr std::uint32_t TABLE_MAGIC = 0x54455252u; // "RRET"
+		constexpr std::uint32_t TABLE_VERSION = 1u;
+		// Four bits per entry, ranks as computed by EndgameTable::rank
+		constexpr std::uint8_t ENCODING_NIBBLES = 1u;
+
+		/**
+		 * File header of a table, values in native byte order
+		 */
+		struct TableHeader {
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint64_t fingerprint;
+			std::uint32_t width;
+			std::uint32_t height;
+			std::uint64_t entries;
+			std::uint32_t goalX;
+			std::uint32_t goalY;
+			std::uint8_t goalType;
+			std::uint8_t goalColor;
+			std::uint8_t encoding;
+			std::uint8_t robotCount;
+			std::uint8_t robots[RICOCHET_ROBOTS_MAX_ROBOT_COUNT];
+			std::uint8_t moves;
+			std::uint8_t reserved[14];
+		};
+		static_assert(sizeof(TableHeader) == 64u, "Table header must be 64 bytes");
+		static_assert(std::is_trivially_copyable<TableHeader>::value, "Table header must be plain data");
+	}
+
+	EndgameTable::EndgameTable(Map const& map, Goal const& goal, std::vector<Color> const& robots, Moves moves) : EndgameTable(map, goal, robots, moves, true) {
+		//
+	}
+
+	EndgameTable::EndgameTable(Map const& map, Goal const& goal, std::vector<Color> const& robots, Moves moves, bool build) :
+			m_map(map), m_goalTest(goal), m_robots(robots), m_moves(moves),
+			m_cells(map.getWidth() * map.getHeight()), m_positions(1u), m_size(0u), m_fileOffset(0u)
+	{
+		if (goal.color != Color::MIX && std::find(robots.cbegin(), robots.cend(), goal.color) == robots.cend()) {
+			throw std::invalid_argument("EndgameTable: Goal robot is not part of the table");
+		}
+		for (auto c: m_robots) {
+			m_positions *= m_cells;
+			if (m_goalTest.isGoalRobot(c)) {
+				m_flagRobots.push_back(c);
+			}
+		}
+		m_size = m_positions << (2u * m_flagRobots.size());
+
+		if (build) {
+			m_data.assign((m_size + 1u) / 2u, 0xFFu);
+			this->build();
+		}
+	}
+
+	EndgameTable EndgameTable::load(Map const& map, std::string const& fileName) {
+		auto file = std::make_shared<MappedFile>(fileName);
+		TableHeader header;
+		if (file->size() < sizeof(header)) {
+			throw std::runtime_error("EndgameTable: " + fileName + " is not a table file");
+		}
+		std::memcpy(&header, file->data(), sizeof(header));
+		if (header.magic != TABLE_MAGIC || header.version != TABLE_VERSION || header.encoding != ENCODING_NIBBLES) {
+			throw std::runtime_error("EndgameTable: " + fileName + " is not a supported table file");
+		}
+		if (header.fingerprint != map.fingerprint() || header.width != map.getWidth() || header.height != map.getHeight()) {
+			throw std::runtime_error("EndgameTable: " + fileName + " was built for a different board");
+		}
+		if (header.robotCount == 0u || header.robotCount > RICOCHET_ROBOTS_MAX_ROBOT_COUNT) {
+			throw std::runtime_error("EndgameTable: Invalid robot count in " + fileName);
+		}
+		if (header.moves != static_cast<std::uint8_t>(Moves::EXACT) && header.moves != static_cast<std::uint8_t>(Moves::ANY_STOP)) {
+			throw std::runtime_error("EndgameTable: Invalid move rules in " + fileName);
+		}
+
+		std::vector<Color> robots;
+		for (unsigned i = 0u; i < header.robotCount; i++) {
+			robots.push_back(colorFromInt(header.robots[i]));
+		}
+		Goal const goal{ goaltypeFromInt(header.goalType), colorFromInt(header.goalColor), Pos(header.goalX, header.goalY) };
+
+		EndgameTable table(map, goal, robots, static_cast<Moves>(header.moves), false);
+		if (table.m_size != header.entries || file->size() != sizeof(header) + (table.m_size + 1u) / 2u) {
+			throw std::runtime_error("EndgameTable: Size mismatch in " + fileName);
+		}
+		table.m_fileOffset = sizeof(header);
+		table.m_file = std::move(file);
+		return table;
+	}
+
+	void EndgameTable::save(std::string const& fileName) const {
+		TableHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = TABLE_MAGIC;
+		header.version = TABLE_VERSION;
+		header.fingerprint = m_map.fingerprint();
+		header.width = static_cast<std::uint32_t>(m_map.getWidth());
+		header.height = static_cast<std::uint32_t>(m_map.getHeight());
+		header.entries = m_size;
+		header.goalX = static_cast<std::uint32_t>(getGoal().pos.x);
+		header.goalY = static_cast<std::uint32_t>(getGoal().pos.y);
+		header.goalType = static_cast<std::uint8_t>(toInt(getGoal().type));
+		header.goalColor = static_cast<std::uint8_t>(toInt(getGoal().color));
+		header.encoding = ENCODING_NIBBLES;
+		header.robotCount = static_cast<std::uint8_t>(m_robots.size());
+		for (std::size_t i = 0u; i < m_robots.size(); i++) {
+			header.robots[i] = static_cast<std::uint8_t>(toInt(m_robots[i]));
+		}
+		header.moves = static_cast<std::uint8_t>(m_moves);
+
+		BinaryWriter out(fileName);
+		out.put(header);
+		std::uint8_t const* entries = m_file ? m_file->data() + m_fileOffset : m_data.data();
+		out.putArray(entries, (m_size + 1u) / 2u);
+		out.commit();
+	}
+
+	std::optional<std::uint64_t> EndgameTable::rank(Map::State const& state, GoalTest::flags_t flags) const {
+		for (auto c: RobotColors) {
+			bool const inTable = std::find(m_robots.cbegin(), m_robots.cend(), c) != m_robots.cend();
+			if (inTable != m_map.posValid(state.robots[toInt(c)])) {
+				return std::nullopt;
+			}
+		}
+
+		std::uint64_t posRank = 0u;
+		for (auto it = m_robots.crbegin(); it != m_robots.crend(); ++it) {
+			posRank = posRank * m_cells + m_map.getCellIndex(state.robots[toInt(*it)]);
+		}
+		std::uint64_t flagRank = 0u;
+		for (auto it = m_flagRobots.crbegin(); it != m_flagRobots.crend(); ++it) {
+			flagRank = (flagRank << 2u) | ((flags >> ((toInt(*it) - 1u) * 2u)) & 0x03u);
+		}
+		return flagRank * m_positions + posRank;
+	}
+
+	bool EndgameTable::unrank(std::uint64_t rank, Map::State& state, GoalTest::flags_t& flags) const {
+		state = m_map.state();
+		for (auto c: RobotColors) {
+			state.robots[toInt(c)] = Pos();
+		}
+
+		std::uint64_t posRank = rank % m_positions;
+		for (auto c: m_robots) {
+			Pos const pos = m_map.getCellPos(posRank % m_cells);
+			posRank /= m_cells;
+			TileType const tile = m_map.getTileType(pos);
+			if (tile != TileType::EMPTY && tile != TileType::GOAL) {
+				return false;
+			}
+			for (auto other: m_robots) {
+				if (other == c) {
+					break;
+				}
+				if (state.robots[toInt(other)] == pos) {
+					return false;
+				}
+			}
+			state.robots[toInt(c)] = pos;
+		}
+		state.hash = m_map.computeHash(state.robots);
+
+		std::uint64_t flagRank = rank / m_positions;
+		flags = 0u;
+		for (auto c: m_flagRobots) {
+			flags = static_cast<GoalTest::flags_t>(flags | ((flagRank & 0x03u) << ((toInt(c) - 1u) * 2u)));
+			flagRank >>= 2u;
+		}
+		return true;
+	}
+
+	void EndgameTable::build() {
+		Map::State state;
+		GoalTest::flags_t flags;
+
+		bool const anyStop = m_moves == Moves::ANY_STOP;
+		std::vector<Map::Predecessor> predecessors;
+		GoalTest::flags_t flagMask = 0u;
+		for (auto c: m_flagRobots) {
+			flagMask = static_cast<GoalTest::flags_t>(flagMask | m_goalTest.update(0u, c, Direction::NORTH) | m_goalTest.update(0u, c, Direction::EAST));
+		}
+
+		// Distance one: moves onto the goal from all positions with a goal
+		// robot on it, with any flags that let the move complete the goal
+		for (std::uint64_t r = 0u; r < m_positions; r++) {
+			if (!unrank(r, state, flags)) {
+				continue;
+			}
+			m_map.loadState(state);
+			for (auto g: m_flagRobots) {
+				if (state.robots[toInt(g)] != getGoal().pos) {
+					continue;
+				}
+				m_map.getPredecessors(g, predecessors, anyStop);
+				for (auto const& p: predecessors) {
+					Map::State previous = state;
+					previous.robots[toInt(g)] = p.pos;
+					for (GoalTest::flags_t f = flagMask;; f = static_cast<GoalTest::flags_t>((f - 1u) & flagMask)) {
+						if (m_goalTest.finishes(m_map, g, p.requested, f)) {
+							auto const prevRank = rank(previous, f);
+							if (prevRank && get(*prevRank) == UNKNOWN) {
+								set(*prevRank, 1u);
+							}
+						}
+						if (f == 0u) {
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// Retrograde analysis: all unknown predecessors of states at the
+		// previous distance are one move further away
+		std::array<GoalTest::flags_t, 2> previousFlags;
+		for (unsigned level = 2u; level <= MAX_DISTANCE; level++) {
+			bool changed = false;
+			for (std::uint64_t r = 0u; r < m_size; r++) {
+				if (get(r) != level - 1u || !unrank(r, state, flags)) {
+					continue;
+				}
+				m_map.loadState(state);
+				for (auto c: m_robots) {
+					m_map.getPredecessors(c, predecessors, anyStop);
+					for (auto const& p: predecessors) {
+						Map::State previous = state;
+						previous.robots[toInt(c)] = p.pos;
+						unsigned const n = m_goalTest.previous(flags, c, p.final, previousFlags);
+						for (unsigned i = 0u; i < n; i++) {
+							auto const prevRank = rank(previous, previousFlags[i]);
+							if (prevRank && get(*prevRank) == UNKNOWN) {
+								set(*prevRank, level);
+								changed = true;
+							}
+						}
+					}
+				}
+			}
+			if (!changed) {
+				break;
+			}
+		}
+	}
+
+	unsigned EndgameTable::distance(Map::State const& state, GoalTest::flags_t flags) const {
+		auto const r = rank(state, flags);
+		if (!r) {
+			return UNKNOWN;
+		}
+		return get(*r);
+	}
+
+	std::optional<MoveSequence> EndgameTable::solve(Map::State const& start) const {
+		if (m_moves != Moves::EXACT) {
+			throw std::logic_error("EndgameTable: Solutions need exact moves");
+		}
+		Map::State state = start;
+		GoalTest::flags_t flags = 0u;
+		unsigned dist = distance(state, flags);
+		if (dist == UNKNOWN) {
+			return std::nullopt;
+		}
+
+		MoveSequence moves;
+		while (dist > 0u) {
+			bool found = false;
+			for (auto c: m_robots) {
+				for (auto requested: AllDirections) {
+					m_map.loadState(state);
+					Direction dir = requested;
+					if (!m_map.moveRobot(c, dir)) {
+						continue;
+					}
+					if (dist == 1u) {
+						found = m_goalTest.finishes(m_map, c, requested, flags);
+					} else {
+						found = distance(m_map.state(), m_goalTest.update(flags, c, dir)) == dist - 1u;
+					}
+					if (found) {
+						moves.push_back({ c, requested });
+						flags = m_goalTest.update(flags, c, dir);
+						state = m_map.state();
+						break;
+					}
+				}
+				if (found) {
+					break;
+				}
+			}
+			if (!found) {
+				throw std::runtime_error("EndgameTable: Inconsistent table");
+			}
+			dist--;
+		}
+		return moves;
+	}
+
+}
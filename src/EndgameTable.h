@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MappedFile.h"
+#include "MoveSequence.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Exact number of moves needed to reach a goal from every configuration
+	 * of a fixed set of robots on a board, all other robots being removed.
+	 * Distances are stored with four bits per state, indexed by the rank
+	 * of the robot positions and the ricochet flags of the goal robots.
+	 * Once built, an optimal solution is found by descending the distances.
+	 *
+	 * With Moves::ANY_STOP, a robot may also stop on any cell it passes, as
+	 * if blocked by one of the removed robots. Every real move is such a
+	 * move, so the distances are lower bounds for boards with more robots.
+	 *
+	 * Tables can be saved to a file: a 64 byte header holding the board
+	 * fingerprint and size, the robots, the goal and the encoding, followed
+	 * by the packed entries. Loading memory maps the file read-only, so
+	 * only the pages touched by queries are read and processes on the same
+	 * host share one copy in the page cache.
+	 */
+	class EndgameTable {
+	public:
+		/// Largest distance that can be stored
+		static constexpr unsigned MAX_DISTANCE = 14u;
+		/// Marks states that can not reach the goal within MAX_DISTANCE moves, or are invalid
+		static constexpr unsigned UNKNOWN = 15u;
+
+		/// How robots move while building the table
+		enum class Moves : std::uint8_t {
+			EXACT = 0,
+			ANY_STOP = 1,
+		};
+
+		/**
+		 * Build the table
+		 * @param map Board, robot positions are ignored
+		 * @param goal Goal to reach
+		 * @param robots Robots on the board, must include the goal color unless it is MIX
+		 * @param moves Move rules, exact or relaxed for lower bounds
+		 */
+		EndgameTable(Map const& map, Goal const& goal, std::vector<Color> const& robots, Moves moves = Moves::EXACT);
+
+		/**
+		 * Open a table file written by save() without reading it into memory
+		 * @param map Board the table was built for
+		 * @param fileName Table file
+		 * @return Table answering queries from the mapped file
+		 */
+		static EndgameTable load(Map const& map, std::string const& fileName);
+
+		/**
+		 * Write the table to a file
+		 * @param fileName Target file, replaced atomically
+		 */
+		void save(std::string const& fileName) const;
+
+		Goal const& getGoal() const {
+			return m_goalTest.getGoal();
+		}
+
+		std::vector<Color> const& getRobots() const {
+			return m_robots;
+		}
+
+		Moves getMoves() const {
+			return m_moves;
+		}
+
+		/**
+		 * @return Number of entries of the table
+		 */
+		std::uint64_t size() const {
+			return m_size;
+		}
+
+		/**
+		 * Compute the index of a state in the table
+		 * @param state State in which exactly the robots of the table are on the board
+		 * @param flags Ricochet flags of the robots
+		 * @return Rank of the state, or nullopt if the state is not covered by the table
+		 */
+		std::optional<std::uint64_t> rank(Map::State const& state, GoalTest::flags_t flags) const;
+
+		/**
+		 * Look up the distance of a state to the goal
+		 * @param state State in which exactly the robots of the table are on the board
+		 * @param flags Ricochet flags of the robots, 0 at the start of a round
+		 * @return Number of moves, or UNKNOWN
+		 */
+		unsigned distance(Map::State const& state, GoalTest::flags_t flags = 0u) const;
+
+		/**
+		 * Find an optimal solution by following decreasing distances.
+		 * Only available for tables with exact moves.
+		 * @param state Start state of the round
+		 * @return Optimal move sequence, if the goal can be reached within MAX_DISTANCE moves
+		 */
+		std::optional<MoveSequence> solve(Map::State const& state) const;
+
+		/**
+		 * Raw value of an entry
+		 * @param rank Index of the entry
+		 * @return Distance or UNKNOWN
+		 */
+		unsigned get(std::uint64_t rank) const {
+			std::uint8_t const* entries = m_file ? m_file->data() + m_fileOffset : m_data.data();
+			return (entries[rank >> 1u] >> ((rank & 1u) * 4u)) & 0x0Fu;
+		}
+	private:
+		mutable Map m_map;
+		GoalTest m_goalTest;
+		std::vector<Color> m_robots;
+		Moves m_moves;
+		// Robots among m_robots that can complete the goal and carry flags
+		std::vector<Color> m_flagRobots;
+		std::uint64_t m_cells;
+		std::uint64_t m_positions;
+		std::uint64_t m_size;
+		// Entries are either owned or in a mapped file
+		std::vector<std::uint8_t> m_data;
+		std::shared_ptr<MappedFile> m_file;
+		std::size_t m_fileOffset;
+
+		EndgameTable(Map const& map, Goal const& goal, std::vector<Color> const& robots, Moves moves, bool build);
+
+		void set(std::uint64_t rank, unsigned value) {
+			std::uint8_t& byte = m_data[rank >> 1u];
+			unsigned const shift = (rank & 1u) * 4u;
+			byte = static_cast<std::uint8_t>((byte & ~(0x0Fu << shift)) | (value << shift));
+		}
+
+		/**
+		 * Decode a rank into a state and flags
+		 * @return false if the rank does not describe a valid configuration
+		 */
+		bool unrank(std::uint64_t rank, Map::State& state, GoalTest::flags_t& flags) const;
+
+		void build();
+	};
+
+}
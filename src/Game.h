@@ -54,6 +54,20 @@ namespace ricochet {
 		 */
 		Goal nextGoal();
 
+		/**
+		 * @return The goal targeted at the moment, if any
+		 */
+		std::optional<Goal> const& getCurrentGoal() const {
+			return m_currentGoal;
+		}
+
+		/**
+		 * @return Goals not drawn yet, nextGoal() picks among them
+		 */
+		std::vector<Goal> const& getRemainingGoals() const {
+			return m_remainingGoals;
+		}
+
 		/**
 		 * Cancel the current goal, allowing nextGoal to pick a new one
 		 * (in case of timeout)
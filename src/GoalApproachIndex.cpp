@@ -0,0 +1,181 @@
+#include "GoalApproachIndex.h"
+
+#include <algorithm>
+
+namespace ricochet {
+
+	GoalApproachIndex::GoalApproachIndex(Map const& map) :
+			m_map(map), m_cells(map.getWidth() * map.getHeight()), m_pathWords((m_cells + 63u) / 64u), m_targetOf(m_cells, NO_CELL)
+	{
+		for (auto const& goal: map.getGoals()) {
+			m_targetOf[map.getCellIndex(goal.pos)] = static_cast<std::uint32_t>(m_targets.size());
+			m_targets.emplace_back();
+			GoalTest const goalTest(goal);
+			for (auto c: RobotColors) {
+				if (goalTest.isGoalRobot(c)) {
+					build(goal, c, m_targets.back());
+				}
+			}
+		}
+	}
+
+	void GoalApproachIndex::build(Goal const& goal, Color c, Target& target) {
+		// Two other robots, one to block behind the goal and one to find the cells that must be free
+		std::vector<Color> others;
+		for (auto r: RobotColors) {
+			if (r != c) {
+				others.push_back(r);
+			}
+		}
+		Color const blockerColor = others[0];
+		Color const probeColor = others[1];
+
+		Map local = m_map;
+		Map::State empty = m_map.state();
+		for (auto r: RobotColors) {
+			empty.robots[toInt(r)] = Pos();
+		}
+		auto standable = [&](std::size_t cell) {
+			TileType const tile = m_map.getTileType(m_map.getCellPos(cell));
+			return tile == TileType::EMPTY || tile == TileType::GOAL;
+		};
+		auto stopsOnGoal = [&](Map::State state, Direction requested, Direction& final) {
+			state.hash = local.computeHash(state.robots);
+			local.loadState(state);
+			final = requested;
+			return local.moveRobot(c, final) && local.state().robots[toInt(c)] == goal.pos;
+		};
+
+		// Cells behind the goal in any direction
+		std::vector<std::uint32_t> blockers{ NO_CELL };
+		for (std::size_t cell = 0u; cell < m_cells; cell++) {
+			Pos const pos = m_map.getCellPos(cell);
+			bool const beside = (pos.x == goal.pos.x && (pos.y + 1u == goal.pos.y || goal.pos.y + 1u == pos.y)) ||
+					(pos.y == goal.pos.y && (pos.x + 1u == goal.pos.x || goal.pos.x + 1u == pos.x));
+			if (beside && standable(cell)) {
+				blockers.push_back(static_cast<std::uint32_t>(cell));
+			}
+		}
+
+		std::vector<std::uint32_t>& offsets = target.offsets[toInt(c) - 1u];
+		offsets.assign(m_cells + 1u, 0u);
+		std::vector<std::uint64_t> path(m_pathWords);
+		for (std::size_t cell = 0u; cell < m_cells; cell++) {
+			offsets[cell] = static_cast<std::uint32_t>(target.approaches.size());
+			Pos const pos = m_map.getCellPos(cell);
+			if (pos == goal.pos || !standable(cell)) {
+				continue;
+			}
+			for (auto requested: AllDirections) {
+				for (std::uint32_t blocker: blockers) {
+					if (blocker == cell) {
+						continue;
+					}
+					Map::State state = empty;
+					state.robots[toInt(c)] = pos;
+					if (blocker != NO_CELL) {
+						state.robots[toInt(blockerColor)] = m_map.getCellPos(blocker);
+					}
+					Direction final;
+					if (!stopsOnGoal(state, requested, final)) {
+						continue;
+					}
+
+					// A robot on any of these cells keeps the move from the goal
+					std::fill(path.begin(), path.end(), 0u);
+					for (std::size_t probe = 0u; probe < m_cells; probe++) {
+						if (probe == cell || probe == blocker || !standable(probe)) {
+							continue;
+						}
+						Map::State probed = state;
+						probed.robots[toInt(probeColor)] = m_map.getCellPos(probe);
+						Direction probedFinal;
+						if (!stopsOnGoal(probed, requested, probedFinal)) {
+							path[probe / 64u] |= static_cast<std::uint64_t>(1u) << (probe % 64u);
+						}
+					}
+					target.approaches.push_back({ requested, final, blocker, static_cast<std::uint32_t>(m_paths.size() / m_pathWords) });
+					m_paths.insert(m_paths.end(), path.cbegin(), path.cend());
+
+					if (blocker == NO_CELL) {
+						// Walls stop the robot, blockers add nothing
+						break;
+					}
+				}
+			}
+		}
+		offsets[m_cells] = static_cast<std::uint32_t>(target.approaches.size());
+	}
+
+	GoalApproachIndex::range_t GoalApproachIndex::approaches(Pos const& goal, Color c, Pos const& from) const {
+		std::uint32_t const t = m_map.posValid(goal) ? m_targetOf[m_map.getCellIndex(goal)] : NO_CELL;
+		if (t == NO_CELL || !m_map.posValid(from)) {
+			return { nullptr, nullptr };
+		}
+		Target const& target = m_targets[t];
+		std::vector<std::uint32_t> const& offsets = target.offsets[toInt(c) - 1u];
+		if (offsets.empty()) {
+			return { nullptr, nullptr };
+		}
+		std::size_t const cell = m_map.getCellIndex(from);
+		return { target.approaches.data() + offsets[cell], target.approaches.data() + offsets[cell + 1u] };
+	}
+
+	bool GoalApproachIndex::usable(Approach const& approach, Map::State const& state, Color c) const {
+		std::uint64_t const* path = m_paths.data() + approach.path * m_pathWords;
+		bool blocked = approach.blocker == NO_CELL;
+		for (auto r: RobotColors) {
+			Pos const& pos = state.robots[toInt(r)];
+			if (r == c || !m_map.posValid(pos)) {
+				continue;
+			}
+			std::size_t const cell = m_map.getCellIndex(pos);
+			if ((path[cell / 64u] >> (cell % 64u)) & 1u) {
+				return false;
+			}
+			if (cell == approach.blocker) {
+				blocked = true;
+			}
+		}
+		return blocked;
+	}
+
+	bool GoalApproachIndex::reaches(Pos const& goal, Map::State const& state, Move const& move) const {
+		range_t const range = approaches(goal, move.color, state.robots[toInt(move.color)]);
+		for (Approach const* a = range.first; a != range.second; a++) {
+			if (a->requested == move.dir && usable(*a, state, move.color)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::optional<Move> GoalApproachIndex::finishingMove(GoalTest const& goalTest, Map::State const& state, GoalTest::flags_t flags) const {
+		for (auto c: RobotColors) {
+			if (!goalTest.isGoalRobot(c)) {
+				continue;
+			}
+			range_t const range = approaches(goalTest.getGoal().pos, c, state.robots[toInt(c)]);
+			for (Approach const* a = range.first; a != range.second; a++) {
+				// An earlier move along the other axis is needed
+				Direction const other = (a->requested == Direction::NORTH || a->requested == Direction::SOUTH) ? Direction::EAST : Direction::NORTH;
+				if ((flags & goalTest.update(0u, c, other)) != 0u && usable(*a, state, c)) {
+					return Move{ c, a->requested };
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+	std::size_t GoalApproachIndex::getMemoryUsage() const {
+		std::size_t bytes = m_targetOf.capacity() * sizeof(std::uint32_t) + m_paths.capacity() * sizeof(std::uint64_t);
+		for (auto const& target: m_targets) {
+			bytes += target.approaches.capacity() * sizeof(Approach);
+			for (auto const& offsets: target.offsets) {
+				bytes += offsets.capacity() * sizeof(std::uint32_t);
+			}
+		}
+		return bytes;
+	}
+
+}
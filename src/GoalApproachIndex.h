@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Color.h"
+#include "Goal.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Last moves onto the goals of a board. For every goal and robot that
+	 * can complete it, lists the moves ending on the goal, either stopped
+	 * by walls alone or by one robot on the cell behind the goal.
+	 * Each approach also knows the cells that have to be free, i.e. those
+	 * where a robot would stop the move before the goal. Whether a robot
+	 * reaches a goal in one move is then a lookup and a test of the robot
+	 * positions against these cells, without moving anything.
+	 */
+	class GoalApproachIndex {
+	public:
+		/// Marks approaches that need no blocking robot
+		static constexpr std::uint32_t NO_CELL = UINT32_MAX;
+
+		struct Approach {
+			/// Direction the move is requested in
+			Direction requested;
+			/// Direction the robot moves in when it stops on the goal
+			Direction final;
+			/// Cell index that must hold a robot, NO_CELL if walls stop the robot
+			std::uint32_t blocker;
+			/// Index of the cells that must be free
+			std::uint32_t path;
+		};
+
+		typedef std::pair<Approach const*, Approach const*> range_t;
+
+		/**
+		 * Build the approaches of all goals on the board
+		 * @param map Board, robot positions are ignored
+		 */
+		explicit GoalApproachIndex(Map const& map);
+
+		/**
+		 * @param goal Position of a goal
+		 * @param c Robot color
+		 * @param from Cell the robot is on
+		 * @return Approaches from that cell, empty if the robot can not complete the goal
+		 */
+		range_t approaches(Pos const& goal, Color c, Pos const& from) const;
+
+		/**
+		 * Check whether a move ends on a goal
+		 * @param goal Position of a goal
+		 * @param state State of all robots before the move
+		 * @param move Move to check
+		 * @return true iff the move stops the robot on the goal
+		 */
+		bool reaches(Pos const& goal, Map::State const& state, Move const& move) const;
+
+		/**
+		 * Find a move that completes a goal, respecting the ricochet rule
+		 * @param goalTest Goal to complete
+		 * @param state State of all robots
+		 * @param flags Ricochet flags of the robots
+		 * @return A completing move, if there is one
+		 */
+		std::optional<Move> finishingMove(GoalTest const& goalTest, Map::State const& state, GoalTest::flags_t flags) const;
+
+		/**
+		 * @return Memory held by the index in bytes
+		 */
+		std::size_t getMemoryUsage() const;
+	private:
+		struct Target {
+			// Per robot color, offsets of the approaches of each cell, empty for robots that can not complete the goal
+			std::array<std::vector<std::uint32_t>, RICOCHET_ROBOTS_MAX_ROBOT_COUNT> offsets;
+			std::vector<Approach> approaches;
+		};
+
+		Map m_map;
+		std::size_t m_cells;
+		std::size_t m_pathWords;
+		// Target of each cell, NO_CELL where there is no goal
+		std::vector<std::uint32_t> m_targetOf;
+		std::vector<Target> m_targets;
+		// Bit sets of cells, m_pathWords words each
+		std::vector<std::uint64_t> m_paths;
+
+		void build(Goal const& goal, Color c, Target& target);
+		bool usable(Approach const& approach, Map::State const& state, Color c) const;
+	};
+
+}
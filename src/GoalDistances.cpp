@@ -0,0 +1,68 @@
+#include "GoalDistances.h"
+#include "GoalTest.h"
+
+#include <algorithm>
+
+namespace ricochet {
+
+	GoalDistances::GoalDistances(Map const& map, Goal const& goal, std::vector<Color> const& robots) : m_map(map) {
+		GoalTest const goalTest(goal);
+		for (auto c: robots) {
+			if (goalTest.isGoalRobot(c) && map.posValid(goal.pos)) {
+				build(c, goal.pos);
+			}
+		}
+	}
+
+	void GoalDistances::build(Color c, Pos const& target) {
+		std::vector<std::uint8_t>& distances = m_distances[toInt(c) - 1u];
+		distances.assign(m_map.getWidth() * m_map.getHeight(), UNREACHABLE);
+
+		Map local = m_map;
+		Map::State state = m_map.state();
+		for (auto r: RobotColors) {
+			state.robots[toInt(r)] = Pos();
+		}
+
+		std::vector<std::size_t> queue{ m_map.getCellIndex(target) };
+		std::vector<Map::Predecessor> predecessors;
+		distances[queue.front()] = 0u;
+		for (std::size_t head = 0u; head < queue.size(); head++) {
+			std::size_t const cell = queue[head];
+			state.robots[toInt(c)] = m_map.getCellPos(cell);
+			state.hash = local.computeHash(state.robots);
+			local.loadState(state);
+			local.getPredecessors(c, predecessors, true);
+			std::uint8_t const next = static_cast<std::uint8_t>(std::min<unsigned>(distances[cell] + 1u, UNREACHABLE - 1u));
+			for (auto const& p: predecessors) {
+				std::size_t const from = m_map.getCellIndex(p.pos);
+				if (distances[from] == UNREACHABLE) {
+					distances[from] = next;
+					queue.push_back(from);
+				}
+			}
+		}
+	}
+
+	unsigned GoalDistances::lowerBound(Map::State const& state) const {
+		unsigned bound = UNREACHABLE;
+		for (auto c: RobotColors) {
+			std::vector<std::uint8_t> const& distances = m_distances[toInt(c) - 1u];
+			Pos const& pos = state.robots[toInt(c)];
+			if (!distances.empty() && m_map.posValid(pos)) {
+				bound = std::min<unsigned>(bound, distances[m_map.getCellIndex(pos)]);
+			}
+		}
+		// The goal is only completed by a move
+		return std::max(bound, 1u);
+	}
+
+	unsigned GoalDistances::distance(Color c, Pos const& pos) const {
+		std::vector<std::uint8_t> const& distances = m_distances[toInt(c) - 1u];
+		if (distances.empty() || !m_map.posValid(pos)) {
+			return UNREACHABLE;
+		}
+		return distances[m_map.getCellIndex(pos)];
+	}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Color.h"
+#include "Goal.h"
+#include "Map.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Admissible heuristic from the robots that can complete a goal, each
+	 * on its own: the number of moves to the goal if the robot could stop
+	 * on any cell it passes, as other robots might make it. Found by a
+	 * breadth first search backwards from the goal.
+	 */
+	class GoalDistances {
+	public:
+		/// Distance of cells from which the goal can not be reached
+		static constexpr unsigned UNREACHABLE = UINT8_MAX;
+
+		/**
+		 * @param map Board, robot positions are ignored
+		 * @param goal Goal to reach
+		 * @param robots Robots that may complete the goal, others are skipped
+		 */
+		GoalDistances(Map const& map, Goal const& goal, std::vector<Color> const& robots);
+
+		/**
+		 * @param state State of all robots
+		 * @return Lower bound on the number of moves to the goal, at least 1, UNREACHABLE if no robot can get there
+		 */
+		unsigned lowerBound(Map::State const& state) const;
+
+		/**
+		 * @param c Robot
+		 * @param pos Cell of the robot
+		 * @return Moves of the robot on its own to the goal, 0 on the goal, UNREACHABLE if it can not complete it
+		 */
+		unsigned distance(Color c, Pos const& pos) const;
+	private:
+		Map m_map;
+		// Per robot color by cell, empty for robots that are skipped
+		std::array<std::vector<std::uint8_t>, RICOCHET_ROBOTS_MAX_ROBOT_COUNT> m_distances;
+
+		void build(Color c, Pos const& target);
+	};
+
+}
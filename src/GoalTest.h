@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Color.h"
+#include "Direction.h"
+#include "Goal.h"
+#include "Map.h"
+
+#include <array>
+#include <cstdint>
+
+namespace ricochet {
+
+	/**
+	 * The rules of Game::doMove for reaching a goal, in a form usable
+	 * during search. A move completes the goal if it brings a robot of the
+	 * goal color (any robot for MIX goals) onto the goal, and that robot
+	 * moved along the other axis earlier on, i.e. it ricocheted at least
+	 * once.
+	 * Whether a robot moved along an axis is part of the search state,
+	 * kept as two flag bits per robot. Flags are only recorded for robots
+	 * that can complete the goal.
+	 */
+	class GoalTest {
+	public:
+		typedef std::uint16_t flags_t;
+
+		/// Number of bits used by the flags of all robots
+		static constexpr unsigned FLAG_BITS = 2u * RICOCHET_ROBOTS_MAX_ROBOT_COUNT;
+
+		explicit GoalTest(Goal const& goal) : m_goal(goal) {}
+
+		Goal const& getGoal() const {
+			return m_goal;
+		}
+
+		/**
+		 * @param c Robot color
+		 * @return true iff a robot of this color can complete the goal
+		 */
+		bool isGoalRobot(Color c) const {
+			return m_goal.color == Color::MIX || m_goal.color == c;
+		}
+
+		/**
+		 * Record a move of a robot
+		 * @param flags Flags before the move
+		 * @param c Moved robot
+		 * @param dir Direction the robot finally moved in, as updated by Map::moveRobot
+		 * @return Flags after the move
+		 */
+		flags_t update(flags_t flags, Color c, Direction dir) const {
+			if (!isGoalRobot(c)) {
+				return flags;
+			}
+			return static_cast<flags_t>(flags | axisFlag(c, dir));
+		}
+
+		/**
+		 * Find the flags a robot could have had before a move, the inverse
+		 * of update()
+		 * @param flags Flags after the move
+		 * @param c Moved robot
+		 * @param dir Direction the robot finally moved in
+		 * @param previous Receives the possible flags before the move
+		 * @return Number of entries stored in previous, zero if no flags lead to the given ones
+		 */
+		unsigned previous(flags_t flags, Color c, Direction dir, std::array<flags_t, 2>& previous) const {
+			if (!isGoalRobot(c)) {
+				previous[0] = flags;
+				return 1u;
+			}
+			flags_t const flag = axisFlag(c, dir);
+			if ((flags & flag) == 0u) {
+				return 0u;
+			}
+			previous[0] = flags;
+			previous[1] = static_cast<flags_t>(flags & ~flag);
+			return 2u;
+		}
+
+		/**
+		 * Check whether a move completes the goal
+		 * @param map Map after the move
+		 * @param c Moved robot
+		 * @param requested Direction the move was requested in
+		 * @param flags Flags before the move
+		 * @return true iff the goal is reached by this move
+		 */
+		bool finishes(Map const& map, Color c, Direction requested, flags_t flags) const {
+			if (!isGoalRobot(c) || map.getRobotPos(c) != m_goal.pos) {
+				return false;
+			}
+			// An earlier move along the other axis is needed
+			Direction const other = (requested == Direction::NORTH || requested == Direction::SOUTH) ? Direction::EAST : Direction::NORTH;
+			return (flags & axisFlag(c, other)) != 0u;
+		}
+	private:
+		Goal m_goal;
+
+		static flags_t axisFlag(Color c, Direction dir) {
+			bool const vertical = (dir == Direction::NORTH || dir == Direction::SOUTH);
+			return static_cast<flags_t>(1u << ((toInt(c) - 1u) * 2u + (vertical ? 0u : 1u)));
+		}
+	};
+
+}
@@ -0,0 +1,173 @@
+#include "IncrementalSolver.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	IncrementalSolver::IncrementalSolver(Map const& map, IncrementalOptions const& options) :
+			m_map(map), m_options(options), m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()),
+			m_expanded(0u), m_optimal(false)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("IncrementalSolver: Board too large");
+		}
+		if (m_options.depthLimit >= UINT8_MAX) {
+			throw std::invalid_argument("IncrementalSolver: Depth limit too large");
+		}
+	}
+
+	std::optional<MoveSequence> IncrementalSolver::solve(Game const& game) {
+		if (!game.getCurrentGoal()) {
+			throw std::invalid_argument("IncrementalSolver: Game has no current goal");
+		}
+		return solve(game.getMap().state(), *game.getCurrentGoal());
+	}
+
+	void IncrementalSolver::prepare(Game const& game) {
+		std::vector<Color> const robots = robotsOn(game.getMap().state());
+		if (game.getCurrentGoal()) {
+			data(*game.getCurrentGoal(), robots);
+		}
+		for (auto const& goal: game.getRemainingGoals()) {
+			data(goal, robots);
+		}
+	}
+
+	std::vector<Color> IncrementalSolver::robotsOn(Map::State const& state) const {
+		std::vector<Color> robots;
+		for (auto c: RobotColors) {
+			if (m_map.posValid(state.robots[toInt(c)])) {
+				robots.push_back(c);
+			}
+		}
+		return robots;
+	}
+
+	IncrementalSolver::GoalData& IncrementalSolver::data(Goal const& goal, std::vector<Color> const& robots) {
+		for (auto& entry: m_goals) {
+			if (entry.goal.type == goal.type && entry.goal.color == goal.color && entry.goal.pos == goal.pos && entry.robots == robots) {
+				return entry;
+			}
+		}
+		m_goals.push_back({ goal, robots, std::nullopt, std::nullopt, {}, 0u });
+		GoalData& entry = m_goals.back();
+		if (m_options.patternDatabases) {
+			entry.database.emplace(m_map, goal, robots);
+		} else {
+			entry.distances.emplace(m_map, goal, robots);
+		}
+		return entry;
+	}
+
+	std::optional<MoveSequence> IncrementalSolver::solve(Map::State const& state, Goal const& goal) {
+		GoalData& entry = data(goal, robotsOn(state));
+		if (auto known = knownSolution(entry, state, goal)) {
+			m_expanded = 0u;
+			m_optimal = true;
+			return known;
+		}
+		m_map.loadState(state);
+
+		AStarOptions options;
+		options.depthLimit = m_options.depthLimit;
+		options.maxStates = m_options.maxStates;
+		options.interrupt = m_options.interrupt;
+		// Learned bounds are near the starts of earlier searches. From a start
+		// without one, looking them up rarely pays for the memory accesses.
+		bool const learned = entry.boundCount != 0u && entry.bounds[slot(entry.bounds, key(state, 0u))].moves != 0u;
+		options.heuristic = [this, &entry, learned](Map::State const& s, GoalTest::flags_t flags) {
+			unsigned bound = entry.database ? std::max(entry.database->lowerBound(s, flags), 1u) : entry.distances->lowerBound(s);
+			if (learned) {
+				bound = std::max<unsigned>(bound, entry.bounds[slot(entry.bounds, key(s, flags))].moves);
+			}
+			return bound;
+		};
+		AStarSearch search(m_map, goal, options);
+		auto solution = search.solve();
+		m_expanded = search.getExpandedStates();
+		m_optimal = !search.interrupted() && !search.limitReached();
+
+		search.learnedBounds([this, &entry](Map::State const& s, GoalTest::flags_t flags, unsigned bound) {
+			insert(entry, key(s, flags), bound);
+		}, m_options.boundsPerSearch);
+		if (solution && m_optimal) {
+			// The moves left are exact along the solution, whatever was stored
+			GoalTest const goalTest(goal);
+			GoalTest::flags_t flags = 0u;
+			for (std::size_t i = 0u; i < solution->size(); i++) {
+				insert(entry, key(m_map.state(), flags), static_cast<unsigned>(solution->size() - i), encodeMove((*solution)[i]));
+				Direction dir = (*solution)[i].dir;
+				m_map.moveRobot((*solution)[i].color, dir);
+				flags = goalTest.update(flags, (*solution)[i].color, dir);
+			}
+		}
+		return solution;
+	}
+
+	std::optional<MoveSequence> IncrementalSolver::knownSolution(GoalData const& entry, Map::State const& state, Goal const& goal) {
+		if (entry.boundCount == 0u) {
+			return std::nullopt;
+		}
+		GoalTest const goalTest(goal);
+		GoalTest::flags_t flags = 0u;
+		MoveSequence moves;
+		m_map.loadState(state);
+		while (true) {
+			// The next move of an exact bound leads to one with a move less
+			Bound const& bound = entry.bounds[slot(entry.bounds, key(m_map.state(), flags))];
+			if (bound.moves == 0u || bound.next == NO_MOVE) {
+				return std::nullopt;
+			}
+			Move const move = decodeMove(bound.next);
+			Direction dir = move.dir;
+			m_map.moveRobot(move.color, dir);
+			moves.push_back(move);
+			if (goalTest.finishes(m_map, move.color, move.dir, flags)) {
+				return moves;
+			}
+			flags = goalTest.update(flags, move.color, dir);
+		}
+	}
+
+	std::size_t IncrementalSolver::slot(std::vector<Bound> const& table, key_t k) {
+		std::size_t const mask = table.size() - 1u;
+		std::size_t i = static_cast<std::size_t>((k * 0x9E3779B97F4A7C15ull) >> 32u) & mask;
+		while (table[i].moves != 0u && table[i].key != k) {
+			i = (i + 1u) & mask;
+		}
+		return i;
+	}
+
+	void IncrementalSolver::insert(GoalData& entry, key_t k, unsigned moves, std::uint8_t next) {
+		if (2u * (entry.boundCount + 1u) > entry.bounds.size()) {
+			std::vector<Bound> table(std::max<std::size_t>(2u * entry.bounds.size(), 1024u), { 0u, 0u, NO_MOVE });
+			for (Bound const& bound: entry.bounds) {
+				if (bound.moves != 0u) {
+					table[slot(table, bound.key)] = bound;
+				}
+			}
+			entry.bounds.swap(table);
+		}
+		Bound& known = entry.bounds[slot(entry.bounds, k)];
+		if (known.moves == 0u) {
+			entry.boundCount++;
+		}
+		// No bound exceeds an exact one
+		if (moves > known.moves || next != NO_MOVE) {
+			known = { k, static_cast<std::uint8_t>(moves), next };
+		}
+	}
+
+	std::size_t IncrementalSolver::getMemoryUsage() const {
+		std::size_t bytes = 0u;
+		for (auto const& entry: m_goals) {
+			if (entry.database) {
+				bytes += entry.database->getMemoryUsage();
+			}
+			bytes += entry.bounds.size() * sizeof(Bound);
+		}
+		return bytes;
+	}
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "AStarSearch.h"
+#include "Game.h"
+#include "Goal.h"
+#include "GoalDistances.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+#include "PatternDatabase.h"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace ricochet {
+
+	struct IncrementalOptions {
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 20u;
+		/// States a search may hold before it gives up, 0 for no limit
+		std::size_t maxStates = 0u;
+		/// Build a PatternDatabase per goal instead of using the distances of the goal robots, once per goal and set of robots
+		bool patternDatabases = false;
+		/// Learned lower bounds kept from each search, those of the states closest to its start
+		std::size_t boundsPerSearch = 1u << 16u;
+		/// Polled during the search, which gives up once it returns true
+		std::function<bool()> interrupt;
+	};
+
+	/**
+	 * Solves the goals of a game one round after the other on the same
+	 * board, keeping what stays valid between the rounds. Heuristic tables
+	 * only depend on the board, the goal and the robots on it, not on
+	 * where the robots are, so they are built once per goal, and
+	 * prepare() builds them for all goals of a game up front. Every
+	 * complete search also proves lower bounds on the moves left from the
+	 * states it stored, see AStarSearch::learnedBounds(); those are kept
+	 * per goal and raise the heuristic of later searches for it. Along the
+	 * solutions returned, the moves left are exact and are stored with the
+	 * next move, so a goal put back with Game::cancelGoal() and drawn
+	 * again, or solved again from a state on a known solution, is answered
+	 * without a search, and from a state near one starts from the learned
+	 * bounds instead of cold. The states explored for one goal say nothing
+	 * about the next one, so after prepare() a round with a new goal
+	 * expands the states a cold search does, but no longer pays for the
+	 * tables, which dominate with patternDatabases.
+	 */
+	class IncrementalSolver {
+	public:
+		/**
+		 * @param map Board, robot positions are ignored
+		 * @param options Search options
+		 */
+		explicit IncrementalSolver(Map const& map, IncrementalOptions const& options = IncrementalOptions());
+
+		/**
+		 * Build the tables for the current and all remaining goals of a
+		 * game, so that no later round waits for them
+		 * @param game Game on the board of this solver
+		 */
+		void prepare(Game const& game);
+
+		/**
+		 * Solve the current goal of a game on the board of this solver
+		 * @param game Game with a current goal
+		 * @return Shortest move sequence reaching the goal, if one is found within the limits
+		 */
+		std::optional<MoveSequence> solve(Game const& game);
+
+		/**
+		 * @param state Robot positions to start from
+		 * @param goal Goal to reach
+		 * @return Shortest move sequence reaching the goal, if one is found within the limits
+		 */
+		std::optional<MoveSequence> solve(Map::State const& state, Goal const& goal);
+
+		/**
+		 * @return Number of states expanded in the last search
+		 */
+		std::size_t getExpandedStates() const {
+			return m_expanded;
+		}
+
+		/**
+		 * @return true iff the last search was complete, its result is optimal
+		 */
+		bool isOptimal() const {
+			return m_optimal;
+		}
+
+		/**
+		 * @return Memory held by the tables and bounds of all goals in bytes
+		 */
+		std::size_t getMemoryUsage() const;
+
+		/**
+		 * Drop everything learned so far
+		 */
+		void clear() {
+			m_goals.clear();
+		}
+	private:
+		typedef std::uint64_t key_t;
+
+		// Marks bounds that are not known to be exact
+		static constexpr std::uint8_t NO_MOVE = UINT8_MAX;
+
+		struct Bound {
+			key_t key;
+			// Learned bounds are at least 1, 0 marks an empty slot
+			std::uint8_t moves;
+			// First move of an optimal solution from the state, if moves is exact
+			std::uint8_t next;
+		};
+
+		struct GoalData {
+			Goal goal;
+			std::vector<Color> robots;
+			std::optional<GoalDistances> distances;
+			std::optional<PatternDatabase> database;
+			// Open addressing table of learned bounds, at most half full
+			std::vector<Bound> bounds;
+			std::size_t boundCount;
+		};
+
+		Map m_map;
+		IncrementalOptions m_options;
+		unsigned m_flagShift;
+		std::vector<GoalData> m_goals;
+		std::size_t m_expanded;
+		bool m_optimal;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		std::vector<Color> robotsOn(Map::State const& state) const;
+		GoalData& data(Goal const& goal, std::vector<Color> const& robots);
+		// Follow the exact bounds from a state, if it has one
+		std::optional<MoveSequence> knownSolution(GoalData const& entry, Map::State const& state, Goal const& goal);
+		static std::size_t slot(std::vector<Bound> const& table, key_t k);
+		static void insert(GoalData& entry, key_t k, unsigned moves, std::uint8_t next = NO_MOVE);
+	};
+
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Bytes moved and time spent in file I/O
+	 */
+	struct IoStats {
+		std::uint64_t bytesRead = 0u;
+		std::uint64_t bytesWritten = 0u;
+		double seconds = 0.0;
+
+		/**
+		 * @return Average throughput of reads and writes in MiB/s
+		 */
+		double throughput() const {
+			if (seconds <= 0.0) {
+				return 0.0;
+			}
+			return static_cast<double>(bytesRead + bytesWritten) / (1024.0 * 1024.0) / seconds;
+		}
+	};
+
+	/**
+	 * Times a block of I/O and adds the duration to the stats
+	 */
+	class IoTimer {
+	public:
+		explicit IoTimer(IoStats& stats) : m_stats(stats), m_start(std::chrono::steady_clock::now()) {}
+		~IoTimer() {
+			m_stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		}
+	private:
+		IoStats& m_stats;
+		std::chrono::steady_clock::time_point const m_start;
+	};
+
+	/**
+	 * Sequential writer for a file of raw 64 bit keys, written in large blocks
+	 */
+	class KeyFileWriter {
+	public:
+		KeyFileWriter(std::string const& fileName, IoStats& stats, std::size_t bufferKeys = 1u << 20u) : m_file(std::fopen(fileName.c_str(), "wb")), m_stats(stats), m_count(0u) {
+			if (m_file == nullptr) {
+				throw std::runtime_error("KeyFileWriter: Could not open " + fileName);
+			}
+			m_buffer.reserve(bufferKeys);
+		}
+
+		~KeyFileWriter() {
+			if (m_file != nullptr) {
+				std::fclose(m_file);
+			}
+		}
+
+		KeyFileWriter(KeyFileWriter const&) = delete;
+		KeyFileWriter& operator=(KeyFileWriter const&) = delete;
+
+		void write(std::uint64_t key) {
+			m_buffer.push_back(key);
+			m_count++;
+			if (m_buffer.size() == m_buffer.capacity()) {
+				flush();
+			}
+		}
+
+		/**
+		 * Flush and close the file, reporting write errors
+		 */
+		void close() {
+			flush();
+			int const res = std::fclose(m_file);
+			m_file = nullptr;
+			if (res != 0) {
+				throw std::runtime_error("KeyFileWriter: Could not close file");
+			}
+		}
+
+		/**
+		 * @return Number of keys written so far
+		 */
+		std::uint64_t count() const {
+			return m_count;
+		}
+	private:
+		std::FILE* m_file;
+		IoStats& m_stats;
+		std::vector<std::uint64_t> m_buffer;
+		std::uint64_t m_count;
+
+		void flush() {
+			if (m_buffer.empty()) {
+				return;
+			}
+			IoTimer timer(m_stats);
+			if (std::fwrite(m_buffer.data(), sizeof(std::uint64_t), m_buffer.size(), m_file) != m_buffer.size()) {
+				throw std::runtime_error("KeyFileWriter: Write failed");
+			}
+			m_stats.bytesWritten += m_buffer.size() * sizeof(std::uint64_t);
+			m_buffer.clear();
+		}
+	};
+
+	/**
+	 * Sequential reader for a file of raw 64 bit keys, read in large blocks
+	 */
+	class KeyFileReader {
+	public:
+		KeyFileReader(std::string const& fileName, IoStats& stats, std::size_t bufferKeys = 1u << 20u) : m_file(std::fopen(fileName.c_str(), "rb")), m_stats(stats), m_buffer(bufferKeys), m_pos(0u), m_end(0u) {
+			if (m_file == nullptr) {
+				throw std::runtime_error("KeyFileReader: Could not open " + fileName);
+			}
+			fill();
+		}
+
+		~KeyFileReader() {
+			if (m_file != nullptr) {
+				std::fclose(m_file);
+			}
+		}
+
+		KeyFileReader(KeyFileReader const&) = delete;
+		KeyFileReader& operator=(KeyFileReader const&) = delete;
+
+		/**
+		 * @return true iff all keys have been consumed
+		 */
+		bool done() const {
+			return m_pos == m_end;
+		}
+
+		/**
+		 * Current key, may only be called if done() is false
+		 */
+		std::uint64_t peek() const {
+			return m_buffer[m_pos];
+		}
+
+		void advance() {
+			if (++m_pos == m_end) {
+				fill();
+			}
+		}
+
+		/**
+		 * Read up to a number of keys into a vector, replacing its contents
+		 * @param keys Vector receiving the keys
+		 * @param maxKeys Maximum number of keys to read
+		 */
+		void read(std::vector<std::uint64_t>& keys, std::size_t maxKeys) {
+			keys.clear();
+			while (!done() && keys.size() < maxKeys) {
+				std::size_t const n = std::min(maxKeys - keys.size(), m_end - m_pos);
+				keys.insert(keys.end(), m_buffer.cbegin() + m_pos, m_buffer.cbegin() + m_pos + n);
+				m_pos += n;
+				if (m_pos == m_end) {
+					fill();
+				}
+			}
+		}
+	private:
+		std::FILE* m_file;
+		IoStats& m_stats;
+		std::vector<std::uint64_t> m_buffer;
+		std::size_t m_pos;
+		std::size_t m_end;
+
+		void fill() {
+			IoTimer timer(m_stats);
+			m_end = std::fread(m_buffer.data(), sizeof(std::uint64_t), m_buffer.size(), m_file);
+			m_pos = 0u;
+			if (m_end == 0u && std::ferror(m_file)) {
+				throw std::runtime_error("KeyFileReader: Read failed");
+			}
+			m_stats.bytesRead += m_end * sizeof(std::uint64_t);
+		}
+	};
+
+}
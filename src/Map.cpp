@@ -1,6 +1,7 @@
 #include "Map.h"
 #include "Random.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <sstream>
@@ -49,7 +50,15 @@ namespace ricochet {
 		for(unsigned i = 0; i < nrHash; i++) {
 			m_hashTable.push_back(Random::random_generator_64()());
 		}
-		m_curState.hash = 0u;
+		m_curState.hash = computeHash(m_curState.robots);
+
+		// Reserve the all ones value for robots that are not on the map
+		m_packedBits = 1u;
+		while ((static_cast<coord>(1u) << m_packedBits) <= size) {
+			m_packedBits++;
+		}
+
+		m_stopPathWords = (size + 63u) / 64u;
 	}
 
 	coord Map::getWidth() const {
@@ -182,6 +191,7 @@ namespace ricochet {
 	}
 
 	void Map::insertWall(Pos const& pos, Direction dir) {
+		m_stopGraph.clear();
 		Pos pos2 = movePos(pos, dir);
 		Direction dir2;
 		switch (dir) {
@@ -220,6 +230,7 @@ namespace ricochet {
 			throw std::runtime_error("insertBarrier: Not empty");
 		}
 
+		m_stopGraph.clear();
 		m_tiles[coord_to_index(pos.x, pos.y)] = b;
 
 		insertSemiWall(pos, Direction::NORTH, true);
@@ -237,6 +248,10 @@ namespace ricochet {
 			throw std::runtime_error("insertRobot: Not empty");
 		}
 
+		Pos const& oldPos = getRobotPos(r.color);
+		if (posValid(oldPos)) {
+			m_curState.hash ^= hash(oldPos.x, oldPos.y, r.color);
+		}
 		m_curState.hash ^= hash(pos.x, pos.y, r.color);
 
 		getRobotPos(r.color) = pos;
@@ -246,6 +261,7 @@ namespace ricochet {
 		if (!posValid(g.pos)) {
 			throw std::range_error("insertGoal: Invalid pos");
 		}
+		m_stopGraph.clear();
 		m_tiles[coord_to_index(g.pos.x, g.pos.y)] = GoalTile{g.type, g.color};
 	}
 
@@ -256,6 +272,7 @@ namespace ricochet {
 		if (m_tiles[coord_to_index(pos.x, pos.y)].getType() != TileType::EMPTY) {
 			throw std::runtime_error("insertInaccessible: Not empty");
 		}
+		m_stopGraph.clear();
 		m_tiles[coord_to_index(pos.x, pos.y)] = Inaccessible{};
 
 		try{
@@ -286,8 +303,8 @@ namespace ricochet {
 	size_t Map::coord_to_index(coord x, coord y) const {
 		assert(x < m_width);
 		assert(y < m_height);
-		assert((y * m_height + x) < (m_width * m_height));
-		return y * m_height + x;
+		assert((y * m_width + x) < (m_width * m_height));
+		return y * m_width + x;
 	}
 
 	Pos Map::index_to_coord(std::size_t index) const {
@@ -324,6 +341,38 @@ namespace ricochet {
 
 	bool Map::moveRobot(Color const& robot, Direction& dir) {
 		Pos& pos = robots()[static_cast<std::underlying_type_t<Color>>(robot)];
+		if (!posValid(pos)) {
+			// Robot is not on the map
+			return false;
+		}
+
+		if (!m_stopGraph.empty()) {
+			StaticMove const& move = m_stopGraph[stopGraphIndex(coord_to_index(pos.x, pos.y), dir, robot)];
+			if (move.path == STRAIGHT) {
+				if (move.length == 0) {
+					return false;
+				}
+				auto const dObs = distToRobot(pos, dir, move.length);
+				if (dObs == 0) {
+					return false;
+				}
+				m_curState.hash ^= hash(pos.x, pos.y, robot);
+				pos = movePos(pos, dir, dObs);
+				m_curState.hash ^= hash(pos.x, pos.y, robot);
+				return true;
+			}
+			if (!robotOnPath(move.path, robot)) {
+				if (move.stop == NO_STOP) {
+					return false;
+				}
+				m_curState.hash ^= hash(pos.x, pos.y, robot);
+				pos = index_to_coord(move.stop);
+				m_curState.hash ^= hash(pos.x, pos.y, robot);
+				dir = move.final;
+				return true;
+			}
+			// A robot is in the way, simulate the move
+		}
 
 		auto dWall = distToWall(pos, dir);
 		if (dWall == 0) {
@@ -338,45 +387,17 @@ namespace ricochet {
 		auto dist = std::min(dObs, dWall);
 		pos = movePos(pos, dir, dist);
 
-		// Cycle detection
-		Pos first = pos;
+		// Cycle detection: the path through barriers is reversible, so it
+		// can only loop by returning to the first barrier the same way
+		Pos const first = pos;
+		Direction const firstDir = dir;
 
 		while(getTile(pos).getType() == TileType::BARRIER) {
 			// If barrier, change direction if required,
 			// update position
 			auto& barrier = getTile(pos).barrier();
 			if (barrier.color != robot) {
-				bool fwd = barrier.alignment == BarrierType::FWD;
-				switch (dir) {
-					case Direction::NORTH:
-						if (fwd) {
-							dir = Direction::EAST;
-						} else {
-							dir = Direction::WEST;
-						}
-						break;
-					case Direction::EAST:
-						if (fwd) {
-							dir = Direction::NORTH;
-						} else {
-							dir = Direction::SOUTH;
-						}
-						break;
-					case Direction::SOUTH:
-						if (fwd) {
-							dir = Direction::WEST;
-						} else {
-							dir = Direction::EAST;
-						}
-						break;
-					case Direction::WEST:
-						if (fwd) {
-							dir = Direction::SOUTH;
-						} else {
-							dir = Direction::NORTH;
-						}
-						break;
-				}
+				dir = deflect(barrier.alignment, dir);
 			}
 
 			dWall = distToWall(pos, dir);
@@ -387,7 +408,8 @@ namespace ricochet {
 				pos = orig;
 				return false;
 			}
-			if (pos == first) {
+			pos = movePos(pos, dir, dist);
+			if (pos == first && dir == firstDir) {
 				// Cycle
 				pos = orig;
 				return false;
@@ -400,6 +422,227 @@ namespace ricochet {
 		return true;
 	}
 
+	bool Map::tracePath(Color const& robot, Pos const& from, Direction& dir, std::vector<Pos>& cells) const {
+		cells.clear();
+		Direction const requested = dir;
+		Pos pos = from;
+		Pos first;
+		do {
+			coord const dist = distToWall(pos, dir);
+			if (dist == 0) {
+				return false;
+			}
+			for (coord i = 1u; i <= dist; i++) {
+				cells.push_back(movePos(pos, dir, i));
+			}
+			pos = cells.back();
+			if (cells.size() == dist) {
+				first = pos;
+			} else if (pos == first && dir == requested) {
+				// Cycle
+				return false;
+			}
+			if (getTile(pos).getType() == TileType::BARRIER) {
+				auto const& barrier = getTile(pos).barrier();
+				if (barrier.color != robot) {
+					dir = deflect(barrier.alignment, dir);
+				}
+			}
+		} while (getTile(pos).getType() == TileType::BARRIER);
+		return true;
+	}
+
+	void Map::buildStopGraph() {
+		std::size_t const size = m_width * m_height;
+		m_stopGraph.assign(size * AllDirections.size() * RICOCHET_ROBOTS_MAX_ROBOT_COUNT, { STRAIGHT, NO_STOP, Direction::NORTH, 0u });
+		m_stopPaths.clear();
+
+		std::vector<Pos> cells;
+		std::vector<std::uint64_t> path(m_stopPathWords);
+		for (std::size_t idx = 0u; idx < size; idx++) {
+			TileType const tile = m_tiles[idx].getType();
+			if (tile != TileType::EMPTY && tile != TileType::GOAL) {
+				continue;
+			}
+			Pos const start = index_to_coord(idx);
+			for (auto c: RobotColors) {
+				for (auto requested: AllDirections) {
+					StaticMove& move = m_stopGraph[stopGraphIndex(idx, requested, c)];
+					Direction dir = requested;
+					bool const stops = tracePath(c, start, dir, cells);
+					move.final = dir;
+					if (stops) {
+						move.stop = static_cast<std::uint32_t>(coord_to_index(cells.back().x, cells.back().y));
+					}
+					bool const straight = std::none_of(cells.cbegin(), cells.cend(), [this](Pos const& p) {
+						return getTile(p).getType() == TileType::BARRIER;
+					});
+					if (straight) {
+						move.length = static_cast<coord>(cells.size());
+						continue;
+					}
+
+					std::fill(path.begin(), path.end(), 0u);
+					for (auto const& p: cells) {
+						std::size_t const cell = coord_to_index(p.x, p.y);
+						path[cell / 64u] |= static_cast<std::uint64_t>(1u) << (cell % 64u);
+					}
+					move.path = static_cast<std::uint32_t>(m_stopPaths.size() / m_stopPathWords);
+					m_stopPaths.insert(m_stopPaths.end(), path.cbegin(), path.cend());
+				}
+			}
+		}
+	}
+
+	bool Map::robotOnPath(std::uint32_t path, Color robot) const {
+		std::uint64_t const* cells = m_stopPaths.data() + path * m_stopPathWords;
+		for (auto c: RobotColors) {
+			Pos const& pos = m_curState.robots[toInt(c)];
+			if (c == robot || !posValid(pos)) {
+				continue;
+			}
+			std::size_t const idx = coord_to_index(pos.x, pos.y);
+			if ((cells[idx / 64u] >> (idx % 64u)) & 1u) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Map::getPredecessors(Color const& robot, std::vector<Predecessor>& result, bool anyStop) const {
+		result.clear();
+		Pos const& target = getRobotPos(robot);
+		if (!posValid(target) || getTile(target).getType() == TileType::BARRIER) {
+			return;
+		}
+
+		auto occupied = [this, &robot](Pos const& pos) {
+			for (auto c: RobotColors) {
+				if (c != robot && state().robots[toInt(c)] == pos) {
+					return true;
+				}
+			}
+			return false;
+		};
+
+		for (auto final: AllDirections) {
+			// A robot right behind the target stops moves that would pass it
+			Pos const behind = movePos(target, final);
+			bool const robotBlocked = posValid(behind) && occupied(behind);
+
+			// Walk backwards along the path. The robot moves in dir from back
+			// towards next, the straight segment ends segment cells ahead at a
+			// barrier or the target. A move from back follows the segment iff
+			// its distance to the next wall, including the clamped distances
+			// next to barriers, equals the segment length. Barrier paths are
+			// reversible, so revisiting the target in the final direction
+			// means a cycle.
+			Direction dir = final;
+			Pos next = target;
+			coord segment = 0u;
+			bool lastSegment = true;
+			std::size_t steps = 0u;
+			std::size_t const maxSteps = 4u * m_width * m_height;
+			while (steps++ < maxSteps) {
+				Pos const back = movePos(next, oppDir(dir));
+				if (!posValid(back) || occupied(back)) {
+					break;
+				}
+				auto const dWall = distToWall(back, dir);
+				if (dWall == 0u || (back == target && dir == final)) {
+					break;
+				}
+				segment++;
+				bool const stops = (anyStop || (lastSegment && robotBlocked)) ? dWall >= segment : dWall == segment;
+
+				Tile const& tile = getTile(back);
+				if (tile.getType() == TileType::BARRIER) {
+					if (!stops) {
+						break;
+					}
+					// The robot left the barrier in dir, find where it entered from
+					if (tile.barrier().color != robot) {
+						dir = deflect(tile.barrier().alignment, dir);
+					}
+					segment = 0u;
+					lastSegment = false;
+				} else if (tile.getType() == TileType::EMPTY || tile.getType() == TileType::GOAL) {
+					if (stops) {
+						result.push_back({ back, dir, final });
+					}
+				} else {
+					break;
+				}
+				next = back;
+			}
+		}
+	}
+
+	Map::PackedState Map::pack(State const& s) const {
+		PackedState const absent = (static_cast<PackedState>(1u) << m_packedBits) - 1u;
+		PackedState p = 0u;
+		for (auto c: RobotColors) {
+			Pos const& pos = s.robots[toInt(c)];
+			PackedState const cell = posValid(pos) ? coord_to_index(pos.x, pos.y) : absent;
+			p |= cell << ((toInt(c) - 1u) * m_packedBits);
+		}
+		return p;
+	}
+
+	Map::State Map::unpack(PackedState p) const {
+		PackedState const absent = (static_cast<PackedState>(1u) << m_packedBits) - 1u;
+		State s;
+		// The first entry is not a robot, keep it as it is on this map
+		s.robots[0] = m_curState.robots[0];
+		for (auto c: RobotColors) {
+			PackedState const cell = (p >> ((toInt(c) - 1u) * m_packedBits)) & absent;
+			s.robots[toInt(c)] = (cell == absent) ? Pos() : index_to_coord(cell);
+		}
+		s.hash = computeHash(s.robots);
+		return s;
+	}
+
+	Map::hash_t Map::computeHash(RobotData const& robots) const {
+		hash_t h = 0u;
+		for (auto c: RobotColors) {
+			Pos const& pos = robots[toInt(c)];
+			if (posValid(pos)) {
+				h ^= hash(pos.x, pos.y, c);
+			}
+		}
+		return h;
+	}
+
+	std::uint64_t Map::fingerprint() const {
+		// FNV-1a
+		std::uint64_t h = 0xcbf29ce484222325ull;
+		auto add = [&h](std::uint64_t value) {
+			for (unsigned i = 0u; i < 8u; i++) {
+				h ^= (value >> (i * 8u)) & 0xFFu;
+				h *= 0x100000001b3ull;
+			}
+		};
+		add(m_width);
+		add(m_height);
+		for (std::size_t idx = 0u; idx < m_tiles.size(); idx++) {
+			add(m_northDist[idx]);
+			add(m_eastDist[idx]);
+			add(m_southDist[idx]);
+			add(m_westDist[idx]);
+
+			Tile const& tile = m_tiles[idx];
+			add(static_cast<std::uint64_t>(tile.getType()));
+			if (tile.getType() == TileType::BARRIER) {
+				add(toInt(tile.barrier().alignment));
+				add(toInt(tile.barrier().color));
+			} else if (tile.getType() == TileType::GOAL) {
+				add(toInt(tile.goal().type));
+				add(toInt(tile.goal().color));
+			}
+		}
+		return h;
+	}
+
 	Pos Map::movePos(Pos const& pos, Direction dir, coord dist) const {
 		switch (dir) {
 			case Direction::NORTH:
@@ -416,7 +659,8 @@ namespace ricochet {
 	}
 
 	coord Map::distToRobot(Pos const &pos, Direction dir, coord maxDist) const {
-		for (auto const& rpos: state().robots) {
+		for (auto c: RobotColors) {
+			Pos const& rpos = state().robots[toInt(c)];
 			switch (dir) {
 				case Direction::NORTH:
 					if (pos.x == rpos.x) {
@@ -435,14 +679,14 @@ namespace ricochet {
 				case Direction::EAST:
 					if (pos.y == rpos.y) {
 						if (pos.x < rpos.x) {
-							maxDist = std::min(maxDist, rpos.y - pos.y - 1);
+							maxDist = std::min(maxDist, rpos.x - pos.x - 1);
 						}
 					}
 					break;
 				case Direction::WEST:
 					if (pos.y == rpos.y) {
 						if (rpos.x < pos.x) {
-							maxDist = std::min(maxDist, pos.y - rpos.y - 1);
+							maxDist = std::min(maxDist, pos.x - rpos.x - 1);
 						}
 					}
 					break;
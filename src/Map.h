@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <variant>
 #include <vector>
@@ -23,6 +24,27 @@ namespace ricochet {
 		Color color;
 	};
 
+	/**
+	 * Direction a robot leaves a barrier in after entering it in dir.
+	 * Deflection is its own inverse: entering in the returned direction
+	 * leaves in dir.
+	 */
+	inline Direction deflect(BarrierType alignment, Direction dir) {
+		bool const fwd = alignment == BarrierType::FWD;
+		switch (dir) {
+			case Direction::NORTH:
+				return fwd ? Direction::EAST : Direction::WEST;
+			case Direction::EAST:
+				return fwd ? Direction::NORTH : Direction::SOUTH;
+			case Direction::SOUTH:
+				return fwd ? Direction::WEST : Direction::EAST;
+			case Direction::WEST:
+				return fwd ? Direction::SOUTH : Direction::NORTH;
+			default:
+				throw std::runtime_error("Invalid Direction value passed to deflect!");
+		}
+	}
+
 
 
 	enum class TileType {
@@ -58,6 +80,19 @@ namespace ricochet {
 	public:
 		typedef std::array<Pos, static_cast<std::underlying_type_t<Color>>(Color::SILVER)+1> RobotData;
 		typedef std::size_t hash_t;
+		typedef std::uint64_t PackedState;
+
+		/**
+		 * A move that ends with a robot at its current position
+		 */
+		struct Predecessor {
+			// Position the robot started from
+			Pos pos;
+			// Direction the move was requested in
+			Direction requested;
+			// Direction the robot moved in when it stopped, as returned by moveRobot
+			Direction final;
+		};
 
 		struct State {
 			RobotData robots;
@@ -98,6 +133,42 @@ namespace ricochet {
 
 		bool moveRobot(Color const& robot, Direction& dir);
 
+		/**
+		 * Follow a move on the board without robots, through barriers.
+		 * With robots, the move stops on the cell before the first one
+		 * occupied; it fails if that is the start or a barrier cell.
+		 * @param robot Moving robot, for the colors of barriers
+		 * @param from Start cell
+		 * @param dir Requested direction, updated to the final direction
+		 * @param cells Receives the cells passed in order, the last one is where the move ends
+		 * @return false iff the move fails, by a wall right behind a barrier or a cycle
+		 */
+		bool tracePath(Color const& robot, Pos const& from, Direction& dir, std::vector<Pos>& cells) const;
+
+		/**
+		 * Precompute where every move ends on the board without robots,
+		 * including barrier deflections. moveRobot then only checks whether
+		 * a robot is in the way: straight moves by comparing robot positions
+		 * with the ray, others by testing the robots against the cells the
+		 * path passes, simulating the move only if one is hit.
+		 * Changing walls, barriers, goals or obstacles drops the graph.
+		 */
+		void buildStopGraph();
+
+		/**
+		 * Find all moves of a robot that end in the current state, the
+		 * inverse of moveRobot. The robot may have started anywhere along
+		 * the rays leading to its position, followed backwards through
+		 * barriers, up to the first wall, robot or non-passable cell.
+		 * Moving the robot from each predecessor position in its requested
+		 * direction leads back to the current state.
+		 * @param robot Robot that moved last
+		 * @param result Receives the predecessors, cleared first
+		 * @param anyStop Also include moves that pass the current position,
+		 * as if another robot could have stopped the robot on any cell
+		 */
+		void getPredecessors(Color const& robot, std::vector<Predecessor>& result, bool anyStop = false) const;
+
 		std::string toString() const;
 
 		Pos const& getRobotPos(Color c) const {
@@ -106,10 +177,34 @@ namespace ricochet {
 
 		std::vector<Goal> getGoals() const;
 
+		/**
+		 * @param pos Valid position
+		 * @return Index of the cell, row major
+		 */
+		std::size_t getCellIndex(Pos const& pos) const {
+			return coord_to_index(pos.x, pos.y);
+		}
+
+		/**
+		 * @param index Cell index, row major
+		 * @return Position of the cell
+		 */
+		Pos getCellPos(std::size_t index) const {
+			return index_to_coord(index);
+		}
+
 		TileType getTileType(Pos const& p) const {
 			return m_tiles[coord_to_index(p.x, p.y)].getType();
 		}
 
+		/**
+		 * @param p Position of a barrier tile
+		 * @return The barrier
+		 */
+		Barrier const& getBarrier(Pos const& p) const {
+			return m_tiles[coord_to_index(p.x, p.y)].barrier();
+		}
+
 		auto push() {
 			m_stateStack.push_back(m_curState);
 			return m_stateStack.size() - 1;
@@ -146,6 +241,42 @@ namespace ricochet {
 		State const& state() const {
 			return m_curState;
 		}
+
+		/**
+		 * Encode the robot positions of a state into a single integer.
+		 * Each robot uses getPackedBitsPerRobot() bits holding its cell
+		 * index, robots not on the map are stored as all ones.
+		 * @param s State to encode
+		 * @return Packed state, unique for the positions of the robots
+		 */
+		PackedState pack(State const& s) const;
+
+		/**
+		 * Decode a packed state, including its hash.
+		 * @param p State encoded by pack()
+		 * @return Decoded state
+		 */
+		State unpack(PackedState p) const;
+
+		unsigned getPackedBitsPerRobot() const {
+			return m_packedBits;
+		}
+
+		/**
+		 * Compute the hash of a set of robot positions from scratch.
+		 * Equals the hash maintained incrementally by insertRobot and moveRobot.
+		 * @param robots Robot positions
+		 * @return Hash of the state
+		 */
+		hash_t computeHash(RobotData const& robots) const;
+
+		/**
+		 * Compute a fingerprint of the board, covering its size, walls,
+		 * barriers, obstacles and goals but not the robots. Stable across
+		 * runs, so it can identify the board in files.
+		 * @return 64 bit fingerprint
+		 */
+		std::uint64_t fingerprint() const;
 	private:
 		coord m_width;
 		coord m_height;
@@ -163,8 +294,38 @@ namespace ricochet {
 
 		std::vector<hash_t> m_hashTable;
 
+		unsigned m_packedBits;
+
+		/**
+		 * End of a move on the board without robots
+		 */
+		struct StaticMove {
+			// Index of the cells passed in m_stopPaths, STRAIGHT if no barrier is hit
+			std::uint32_t path;
+			// Cell index of the end, NO_STOP if the move fails
+			std::uint32_t stop;
+			// Direction the robot moves in when it stops
+			Direction final;
+			// Length of straight moves
+			coord length;
+		};
+		static constexpr std::uint32_t STRAIGHT = UINT32_MAX;
+		static constexpr std::uint32_t NO_STOP = UINT32_MAX;
+
+		// Indexed by cell, direction and robot color, empty if not built
+		std::vector<StaticMove> m_stopGraph;
+		// Bit sets of cells, m_stopPathWords words each
+		std::vector<std::uint64_t> m_stopPaths;
+		std::size_t m_stopPathWords;
+
+		std::size_t stopGraphIndex(std::size_t cell, Direction dir, Color c) const {
+			return (cell * AllDirections.size() + toInt(dir) - 1u) * RICOCHET_ROBOTS_MAX_ROBOT_COUNT + toInt(c) - 1u;
+		}
+
+		bool robotOnPath(std::uint32_t path, Color robot) const;
+
 		hash_t hash(coord x, coord y, Color c) const {
-			return m_hashTable[coord_to_index(x, y) * (static_cast<std::underlying_type_t<Color>>(c))];
+			return m_hashTable[coord_to_index(x, y) * RICOCHET_ROBOTS_MAX_ROBOT_COUNT + static_cast<std::underlying_type_t<Color>>(c) - 1u];
 		}
 
 		RobotData& robots() {
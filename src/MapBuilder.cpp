@@ -214,6 +214,7 @@ namespace ricochet {
 		for(auto const& g: m_goals) {
 			map.insertGoal(Goal{g.goalType, g.goalColor, g.position});
 		}
+		map.buildStopGraph();
 		return map;
 	}
 
@@ -0,0 +1,95 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ricochet {
+
+#if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
+
+	MappedFile::MappedFile(std::string const& fileName) : m_data(nullptr), m_size(0u), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr) {
+		m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("MappedFile: Could not open " + fileName);
+		}
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size)) {
+			CloseHandle(m_file);
+			throw std::runtime_error("MappedFile: Could not get size of " + fileName);
+		}
+		m_size = static_cast<std::size_t>(size.QuadPart);
+		if (m_size == 0u) {
+			return;
+		}
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping == nullptr) {
+			CloseHandle(m_file);
+			throw std::runtime_error("MappedFile: Could not map " + fileName);
+		}
+		m_data = static_cast<std::uint8_t const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (m_data == nullptr) {
+			CloseHandle(m_mapping);
+			CloseHandle(m_file);
+			throw std::runtime_error("MappedFile: Could not map " + fileName);
+		}
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_data != nullptr) {
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping != nullptr) {
+			CloseHandle(m_mapping);
+		}
+		if (m_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_file);
+		}
+	}
+
+#else
+
+	MappedFile::MappedFile(std::string const& fileName) : m_data(nullptr), m_size(0u) {
+		int const fd = open(fileName.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("MappedFile: Could not open " + fileName);
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			close(fd);
+			throw std::runtime_error("MappedFile: Could not get size of " + fileName);
+		}
+		m_size = static_cast<std::size_t>(st.st_size);
+		if (m_size == 0u) {
+			close(fd);
+			return;
+		}
+		void* const addr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+		// The mapping stays valid after closing the descriptor
+		close(fd);
+		if (addr == MAP_FAILED) {
+			throw std::runtime_error("MappedFile: Could not map " + fileName);
+		}
+		// Table lookups jump around, read ahead would only waste memory
+		madvise(addr, m_size, MADV_RANDOM);
+		m_data = static_cast<std::uint8_t const*>(addr);
+	}
+
+	MappedFile::~MappedFile() {
+		if (m_data != nullptr) {
+			munmap(const_cast<std::uint8_t*>(m_data), m_size);
+		}
+	}
+
+#endif
+
+}
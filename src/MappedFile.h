@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ricochet {
+
+	/**
+	 * Read-only memory mapping of a whole file. Pages are loaded by the
+	 * operating system when touched and shared between all processes
+	 * mapping the same file.
+	 */
+	class MappedFile {
+	public:
+		explicit MappedFile(std::string const& fileName);
+		~MappedFile();
+
+		MappedFile(MappedFile const&) = delete;
+		MappedFile& operator=(MappedFile const&) = delete;
+
+		std::uint8_t const* data() const {
+			return m_data;
+		}
+
+		std::size_t size() const {
+			return m_size;
+		}
+	private:
+		std::uint8_t const* m_data;
+		std::size_t m_size;
+#if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+
+}
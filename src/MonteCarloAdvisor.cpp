@@ -0,0 +1,205 @@
+#include "MonteCarloAdvisor.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace ricochet {
+
+	namespace {
+		std::vector<Color> movableRobots(Map const& map, std::vector<Color> const& robots) {
+			std::vector<Color> result;
+			for (auto c: RobotColors) {
+				if (map.posValid(map.getRobotPos(c)) && (robots.empty() || std::find(robots.cbegin(), robots.cend(), c) != robots.cend())) {
+					result.push_back(c);
+				}
+			}
+			return result;
+		}
+	}
+
+	MonteCarloAdvisor::MonteCarloAdvisor(Map const& map, Goal const& goal, AdvisorOptions const& options) :
+			m_map(map), m_goalTest(goal), m_options(options), m_start(map.state()), m_robots(movableRobots(map, options.robots)),
+			m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()), m_goalDistances(map, goal, m_robots)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("MonteCarloAdvisor: Board too large");
+		}
+	}
+
+	std::vector<MoveAdvice> MonteCarloAdvisor::advise() {
+		auto const deadline = std::chrono::steady_clock::now() + m_options.budget;
+		unsigned const threads = std::max(1u, m_options.threads);
+
+		// The shared generator is not thread safe, seed one per thread here
+		std::vector<std::mt19937> generators;
+		for (unsigned t = 0u; t < threads; t++) {
+			generators.emplace_back(Random::random_generator()());
+		}
+		std::vector<Tree> trees(threads);
+		auto worker = [&](unsigned t) {
+			search(trees[t], generators[t], deadline);
+		};
+		std::vector<std::thread> pool;
+		for (unsigned t = 1u; t < threads; t++) {
+			pool.emplace_back(worker, t);
+		}
+		worker(0u);
+		for (auto& thread: pool) {
+			thread.join();
+		}
+
+		// Sum up the first moves of all trees
+		std::array<std::pair<std::size_t, double>, 32u> totals{};
+		m_bestSolution.reset();
+		for (auto const& tree: trees) {
+			TreeNode const& root = tree.nodes.front();
+			for (std::uint32_t i = 0u; root.firstChild != NONE && i < root.childCount; i++) {
+				TreeNode const& child = tree.nodes[root.firstChild + i];
+				totals[child.move].first += child.visits;
+				totals[child.move].second += child.reward;
+			}
+			if (tree.bestSolution && (!m_bestSolution || tree.bestSolution->size() < m_bestSolution->size())) {
+				m_bestSolution = tree.bestSolution;
+			}
+		}
+		std::vector<MoveAdvice> advice;
+		for (std::size_t move = 0u; move < totals.size(); move++) {
+			if (totals[move].first != 0u) {
+				advice.push_back({ decodeMove(static_cast<std::uint8_t>(move)), totals[move].first, totals[move].second / static_cast<double>(totals[move].first) });
+			}
+		}
+		std::sort(advice.begin(), advice.end(), [](MoveAdvice const& a, MoveAdvice const& b) {
+			return a.visits != b.visits ? a.visits > b.visits : a.value > b.value;
+		});
+		return advice;
+	}
+
+	void MonteCarloAdvisor::search(Tree& tree, std::mt19937& rng, std::chrono::steady_clock::time_point deadline) const {
+		Map map = m_map;
+		key_t const stateMask = (static_cast<key_t>(1u) << m_flagShift) - 1u;
+		tree.nodes.push_back({ key(m_start, 0u), NONE, 0u, 0u, false, 0u, 0.0 });
+
+		std::vector<std::uint32_t> path;
+		MoveSequence moves;
+		for (std::size_t iteration = 0u;; iteration++) {
+			if ((iteration & 0x3Fu) == 0u && std::chrono::steady_clock::now() >= deadline) {
+				break;
+			}
+
+			// Selection
+			path.assign(1u, 0u);
+			moves.clear();
+			std::uint32_t index = 0u;
+			while (tree.nodes[index].firstChild != NONE && tree.nodes[index].childCount != 0u) {
+				TreeNode const& node = tree.nodes[index];
+				double const logVisits = std::log(static_cast<double>(std::max(node.visits, 1u)));
+				std::uint32_t selected = node.firstChild;
+				double bestScore = -1.0;
+				for (std::uint32_t i = node.firstChild; i < node.firstChild + node.childCount; i++) {
+					TreeNode const& child = tree.nodes[i];
+					if (child.visits == 0u) {
+						selected = i;
+						break;
+					}
+					double const score = child.reward / child.visits + m_options.exploration * std::sqrt(logVisits / child.visits);
+					if (score > bestScore) {
+						bestScore = score;
+						selected = i;
+					}
+				}
+				index = selected;
+				path.push_back(index);
+				moves.push_back(decodeMove(tree.nodes[index].move));
+				if (tree.nodes[index].terminal) {
+					break;
+				}
+			}
+
+			// Expansion
+			if (!tree.nodes[index].terminal && tree.nodes[index].firstChild == NONE && tree.nodes.size() < m_options.maxNodes) {
+				expand(tree, index, map);
+				TreeNode const& node = tree.nodes[index];
+				if (node.childCount != 0u) {
+					index = node.firstChild + static_cast<std::uint32_t>(rng() % node.childCount);
+					path.push_back(index);
+					moves.push_back(decodeMove(tree.nodes[index].move));
+				}
+			}
+
+			// Simulation
+			double reward;
+			bool solved = tree.nodes[index].terminal;
+			if (solved) {
+				reward = solvedReward(moves.size());
+			} else {
+				key_t const k = tree.nodes[index].key;
+				map.loadState(map.unpack(k & stateMask));
+				reward = playout(map, static_cast<GoalTest::flags_t>(k >> m_flagShift), moves, rng, solved);
+			}
+			if (solved && (!tree.bestSolution || moves.size() < tree.bestSolution->size())) {
+				tree.bestSolution = moves;
+			}
+
+			// Backpropagation
+			for (std::uint32_t i: path) {
+				tree.nodes[i].visits++;
+				tree.nodes[i].reward += reward;
+			}
+		}
+	}
+
+	void MonteCarloAdvisor::expand(Tree& tree, std::uint32_t index, Map& map) const {
+		key_t const k = tree.nodes[index].key;
+		Map::State const state = map.unpack(k & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+		GoalTest::flags_t const flags = static_cast<GoalTest::flags_t>(k >> m_flagShift);
+		std::uint32_t const first = static_cast<std::uint32_t>(tree.nodes.size());
+		for (auto c: m_robots) {
+			for (auto requested: AllDirections) {
+				map.loadState(state);
+				Direction dir = requested;
+				if (!map.moveRobot(c, dir)) {
+					continue;
+				}
+				bool const terminal = m_goalTest.finishes(map, c, requested, flags);
+				key_t const childKey = terminal ? 0u : key(map.state(), m_goalTest.update(flags, c, dir));
+				tree.nodes.push_back({ childKey, NONE, 0u, encodeMove({ c, requested }), terminal, 0u, 0.0 });
+			}
+		}
+		tree.nodes[index].firstChild = first;
+		tree.nodes[index].childCount = static_cast<std::uint8_t>(tree.nodes.size() - first);
+	}
+
+	double MonteCarloAdvisor::playout(Map& map, GoalTest::flags_t flags, MoveSequence& moves, std::mt19937& rng, bool& solved) const {
+		solved = false;
+		if (m_robots.empty()) {
+			return 0.0;
+		}
+		unsigned closest = m_goalDistances.lowerBound(map.state());
+		std::size_t const start = moves.size();
+		for (unsigned tries = 0u; moves.size() - start < m_options.playoutDepth && tries < 4u * m_options.playoutDepth; tries++) {
+			Color const c = m_robots[rng() % m_robots.size()];
+			Direction const requested = AllDirections[rng() % AllDirections.size()];
+			Direction dir = requested;
+			if (!map.moveRobot(c, dir)) {
+				continue;
+			}
+			moves.push_back({ c, requested });
+			if (m_goalTest.finishes(map, c, requested, flags)) {
+				solved = true;
+				return solvedReward(moves.size());
+			}
+			flags = m_goalTest.update(flags, c, dir);
+			closest = std::min(closest, m_goalDistances.lowerBound(map.state()));
+		}
+		return 0.25 / closest;
+	}
+
+	double MonteCarloAdvisor::solvedReward(std::size_t length) const {
+		return 0.5 + 0.5 / static_cast<double>(length);
+	}
+
+}
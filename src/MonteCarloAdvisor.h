@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalDistances.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace ricochet {
+
+	struct AdvisorOptions {
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Time to think
+		std::chrono::milliseconds budget{ 20 };
+		/// Number of independent trees, each searched by its own thread
+		unsigned threads = 1u;
+		/// Moves in a random playout
+		unsigned playoutDepth = 12u;
+		/// Weight of exploration in the UCT rule
+		double exploration = 0.7;
+		/// Nodes per tree, leaves are no longer expanded beyond this
+		std::size_t maxNodes = 200000u;
+	};
+
+	struct MoveAdvice {
+		Move move;
+		/// Playouts that started with the move
+		std::size_t visits;
+		/// Mean reward of these playouts, from 0 to 1
+		double value;
+	};
+
+	/**
+	 * Hint engine suggesting a first move with Monte Carlo tree search.
+	 * Each iteration walks the tree choosing children by UCT, expands a
+	 * leaf and plays random moves from it. A playout that completes the
+	 * goal is rewarded more the shorter the whole sequence is; one that
+	 * does not gets a small reward from the closest any goal robot got.
+	 * Parallel searches grow separate trees whose statistics of the first
+	 * moves are summed up (root parallelism).
+	 */
+	class MonteCarloAdvisor {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		MonteCarloAdvisor(Map const& map, Goal const& goal, AdvisorOptions const& options = AdvisorOptions());
+
+		/**
+		 * Search for the time budget
+		 * @return First moves, most visited first
+		 */
+		std::vector<MoveAdvice> advise();
+
+		/**
+		 * @return Shortest solution seen in the last search, if any
+		 */
+		std::optional<MoveSequence> const& getBestSolution() const {
+			return m_bestSolution;
+		}
+	private:
+		typedef std::uint64_t key_t;
+
+		static constexpr std::uint32_t NONE = UINT32_MAX;
+
+		struct TreeNode {
+			key_t key;
+			// Children are stored consecutively, NONE until expanded
+			std::uint32_t firstChild;
+			std::uint8_t childCount;
+			std::uint8_t move;
+			// The move to this node completes the goal
+			bool terminal;
+			std::uint32_t visits;
+			double reward;
+		};
+
+		struct Tree {
+			std::vector<TreeNode> nodes;
+			std::optional<MoveSequence> bestSolution;
+		};
+
+		Map m_map;
+		GoalTest m_goalTest;
+		AdvisorOptions m_options;
+		Map::State m_start;
+		std::vector<Color> m_robots;
+		unsigned m_flagShift;
+		GoalDistances m_goalDistances;
+		std::optional<MoveSequence> m_bestSolution;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		void search(Tree& tree, std::mt19937& rng, std::chrono::steady_clock::time_point deadline) const;
+		void expand(Tree& tree, std::uint32_t index, Map& map) const;
+		double playout(Map& map, GoalTest::flags_t flags, MoveSequence& moves, std::mt19937& rng, bool& solved) const;
+		double solvedReward(std::size_t length) const;
+	};
+
+}
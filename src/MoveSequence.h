@@ -3,6 +3,7 @@
 #include "Color.h"
 #include "Direction.h"
 
+#include <cstdint>
 #include <vector>
 
 namespace ricochet {
@@ -21,4 +22,23 @@ namespace ricochet {
 
 	typedef std::vector<Move> MoveSequence;
 
+	/**
+	 * Encode a move into a single byte: two bits for the direction,
+	 * the color in the bits above
+	 * @param move Move to encode
+	 * @return Encoded move
+	 */
+	inline std::uint8_t encodeMove(Move const& move) {
+		return static_cast<std::uint8_t>(((toInt(move.color) - 1u) << 2u) | (toInt(move.dir) - 1u));
+	}
+
+	/**
+	 * Decode a move encoded by encodeMove
+	 * @param code Encoded move
+	 * @return Decoded move
+	 */
+	inline Move decodeMove(std::uint8_t code) {
+		return { colorFromInt(static_cast<color_t>((code >> 2u) + 1u)), directionFromInt(static_cast<direction_t>((code & 0x03u) + 1u)) };
+	}
+
 }
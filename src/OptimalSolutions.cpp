@@ -0,0 +1,221 @@
+#include "OptimalSolutions.h"
+#include "AStarSearch.h"
+#include "GoalDistances.h"
+#include "RadixSort.h"
+#include "RobotRelevance.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	namespace {
+		std::uint64_t saturatingAdd(std::uint64_t a, std::uint64_t b) {
+			return a > UINT64_MAX - b ? UINT64_MAX : a + b;
+		}
+
+		// Remove the keys of a sorted range from sorted keys
+		void subtract(std::vector<std::uint64_t>& keys, std::vector<std::uint64_t> const& other) {
+			auto out = keys.begin();
+			auto it = other.cbegin();
+			for (std::uint64_t const k: keys) {
+				it = std::lower_bound(it, other.cend(), k);
+				if (it == other.cend() || *it != k) {
+					*out++ = k;
+				}
+			}
+			keys.erase(out, keys.end());
+		}
+	}
+
+	OptimalSolutions::OptimalSolutions(Map const& map, Goal const& goal, OptimalSolutionsOptions const& options) :
+			m_map(map), m_goalTest(goal), m_options(options), m_start(map.state()),
+			m_flagShift(RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot()),
+			m_length(0u), m_limitReached(false)
+	{
+		if (m_flagShift + GoalTest::FLAG_BITS > 64u) {
+			throw std::invalid_argument("OptimalSolutions: Board too large");
+		}
+		if (m_options.depthLimit >= UINT8_MAX) {
+			throw std::invalid_argument("OptimalSolutions: Depth limit too large");
+		}
+		for (auto c: RobotColors) {
+			if (!map.posValid(map.getRobotPos(c))) {
+				continue;
+			}
+			if (m_options.robots.empty() || std::find(m_options.robots.cbegin(), m_options.robots.cend(), c) != m_options.robots.cend()) {
+				m_robots.push_back(c);
+			}
+		}
+		if (!m_robots.empty()) {
+			m_robots = RobotRelevance(map, goal, m_robots).relevantRobots(m_options.depthLimit);
+		}
+	}
+
+	void OptimalSolutions::expand(key_t k, std::function<void(Move const&, bool, key_t)> const& visit) const {
+		Map::State const state = m_map.unpack(k & ((static_cast<key_t>(1u) << m_flagShift) - 1u));
+		GoalTest::flags_t const flags = static_cast<GoalTest::flags_t>(k >> m_flagShift);
+		for (auto c: m_robots) {
+			for (auto requested: AllDirections) {
+				m_map.loadState(state);
+				Direction dir = requested;
+				if (!m_map.moveRobot(c, dir)) {
+					continue;
+				}
+				if (m_goalTest.finishes(m_map, c, requested, flags)) {
+					visit({ c, requested }, true, 0u);
+				} else {
+					visit({ c, requested }, false, key(m_map.state(), m_goalTest.update(flags, c, dir)));
+				}
+			}
+		}
+	}
+
+	std::uint64_t OptimalSolutions::count(std::size_t depth, key_t k) const {
+		Layer const& layer = m_layers[depth];
+		auto const it = std::lower_bound(layer.keys.cbegin(), layer.keys.cend(), k);
+		if (it == layer.keys.cend() || *it != k) {
+			return 0u;
+		}
+		return layer.counts[static_cast<std::size_t>(it - layer.keys.cbegin())];
+	}
+
+	bool OptimalSolutions::search() {
+		m_layers.clear();
+		m_length = 0u;
+		m_limitReached = false;
+
+		// The optimal length first, so that only states that can still be on an optimal solution are kept
+		AStarOptions options;
+		options.robots = m_robots;
+		options.depthLimit = m_options.depthLimit;
+		options.maxStates = m_options.maxStates;
+		AStarSearch astar(m_map, m_goalTest.getGoal(), options);
+		auto const solution = astar.solve();
+		if (!solution) {
+			m_limitReached = astar.limitReached();
+			return false;
+		}
+		unsigned const length = static_cast<unsigned>(solution->size());
+		GoalDistances const distances(m_map, m_goalTest.getGoal(), m_robots);
+
+		// Forward until the layer before the last move. Pruning keeps the
+		// depth of the states of optimal solutions: every state on a shortest
+		// path to one of them is on an optimal solution as well.
+		m_layers.push_back({ { key(m_start, 0u) }, {} });
+		std::size_t stored = 1u;
+		while (m_layers.size() < length) {
+			unsigned const depth = static_cast<unsigned>(m_layers.size());
+			std::vector<key_t> next;
+			for (key_t const k: m_layers.back().keys) {
+				expand(k, [&](Move const&, bool finishes, key_t child) {
+					if (!finishes && depth + distances.lowerBound(m_map.state()) <= length) {
+						next.push_back(child);
+					}
+				});
+			}
+			radixSort(next, m_flagShift + GoalTest::FLAG_BITS);
+			next.erase(std::unique(next.begin(), next.end()), next.end());
+			for (auto it = m_layers.crbegin(); it != m_layers.crend() && !next.empty(); ++it) {
+				subtract(next, it->keys);
+			}
+			stored += next.size();
+			if (m_options.maxStates != 0u && stored > m_options.maxStates) {
+				m_limitReached = true;
+				m_layers.clear();
+				return false;
+			}
+			m_layers.push_back({ std::move(next), {} });
+		}
+		m_length = length;
+
+		// Backward, counting the sequences to the goal and dropping states without any
+		for (std::size_t depth = m_layers.size(); depth-- > 0u;) {
+			Layer& layer = m_layers[depth];
+			bool const last = depth + 1u == m_layers.size();
+			std::size_t kept = 0u;
+			for (std::size_t i = 0u; i < layer.keys.size(); i++) {
+				std::uint64_t sequences = 0u;
+				expand(layer.keys[i], [&](Move const&, bool finishes, key_t child) {
+					if (last) {
+						sequences += finishes ? 1u : 0u;
+					} else if (!finishes) {
+						sequences = saturatingAdd(sequences, count(depth + 1u, child));
+					}
+				});
+				if (sequences != 0u) {
+					layer.keys[kept++] = layer.keys[i];
+					layer.counts.push_back(sequences);
+				}
+			}
+			layer.keys.resize(kept);
+			layer.keys.shrink_to_fit();
+		}
+		return true;
+	}
+
+	MoveSequence OptimalSolutions::getSolution(std::uint64_t index) const {
+		if (index >= getCount()) {
+			throw std::out_of_range("OptimalSolutions: Solution index out of range");
+		}
+		MoveSequence moves;
+		key_t k = m_layers.front().keys.front();
+		for (std::size_t depth = 0u; depth < m_layers.size(); depth++) {
+			bool const last = depth + 1u == m_layers.size();
+			bool chosen = false;
+			key_t next = 0u;
+			expand(k, [&](Move const& move, bool finishes, key_t child) {
+				if (chosen || finishes != last) {
+					return;
+				}
+				std::uint64_t const sequences = last ? 1u : count(depth + 1u, child);
+				if (index < sequences) {
+					moves.push_back(move);
+					next = child;
+					chosen = true;
+				} else {
+					index -= sequences;
+				}
+			});
+			k = next;
+		}
+		return moves;
+	}
+
+	void OptimalSolutions::enumerate(std::function<bool(MoveSequence const&)> const& visit) const {
+		if (m_layers.empty()) {
+			return;
+		}
+		MoveSequence moves;
+		enumerate(0u, m_layers.front().keys.front(), moves, visit);
+	}
+
+	bool OptimalSolutions::enumerate(std::size_t depth, key_t k, MoveSequence& moves, std::function<bool(MoveSequence const&)> const& visit) const {
+		bool const last = depth + 1u == m_layers.size();
+		// Collect the moves first, the recursion reuses the scratch map
+		std::vector<std::pair<Move, key_t>> continuations;
+		expand(k, [&](Move const& move, bool finishes, key_t child) {
+			if (finishes == last && (last || count(depth + 1u, child) != 0u)) {
+				continuations.push_back({ move, child });
+			}
+		});
+		for (auto const& continuation: continuations) {
+			moves.push_back(continuation.first);
+			bool const more = last ? visit(moves) : enumerate(depth + 1u, continuation.second, moves, visit);
+			moves.pop_back();
+			if (!more) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::size_t OptimalSolutions::getMemoryUsage() const {
+		std::size_t bytes = 0u;
+		for (auto const& layer: m_layers) {
+			bytes += layer.keys.capacity() * sizeof(key_t) + layer.counts.capacity() * sizeof(std::uint64_t);
+		}
+		return bytes;
+	}
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Goal.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ricochet {
+
+	struct OptimalSolutionsOptions {
+		/// Robots that may move, all robots on the board if empty. Other robots stay where they are.
+		std::vector<Color> robots;
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 20u;
+		/// Give up once this many states are stored, 0 for no limit
+		std::size_t maxStates = 0u;
+	};
+
+	/**
+	 * Counts and enumerates all optimal solutions of a goal, as distinct
+	 * move sequences. Once AStarSearch found the optimal length, a breadth
+	 * first search over states and ricochet flags keeps each layer as a
+	 * sorted list of packed keys, up to the layer before the last move.
+	 * Every state of an optimal solution is at its BFS depth, otherwise a
+	 * shorter solution would exist, and states whose depth and
+	 * GoalDistances exceed the optimal length are dropped. Going back over
+	 * the layers, each state is given the number of optimal move sequences
+	 * from it to the goal: its completing moves in the last layer, the sum
+	 * over its moves into the next layer before. States without any are
+	 * dropped. Enumeration then walks forward along states with sequences
+	 * left, and the numbers rank the solutions, so any one of them, e.g. a
+	 * uniformly random one, is found without visiting the others.
+	 * Robots that can not affect the goal within depthLimit moves are left
+	 * out, see RobotRelevance: their moves are never part of an optimal
+	 * solution.
+	 */
+	class OptimalSolutions {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param options Search options
+		 */
+		OptimalSolutions(Map const& map, Goal const& goal, OptimalSolutionsOptions const& options = OptimalSolutionsOptions());
+
+		/**
+		 * Search the layers and count the solutions
+		 * @return true iff there is a solution within depthLimit and maxStates
+		 */
+		bool search();
+
+		/**
+		 * @return Number of moves of the optimal solutions, 0 if none were found
+		 */
+		unsigned getLength() const {
+			return m_length;
+		}
+
+		/**
+		 * @return Number of optimal solutions, saturating at UINT64_MAX
+		 */
+		std::uint64_t getCount() const {
+			return m_layers.empty() ? 0u : m_layers.front().counts.front();
+		}
+
+		/**
+		 * @return true iff the last search stopped at maxStates
+		 */
+		bool limitReached() const {
+			return m_limitReached;
+		}
+
+		/**
+		 * @param index Rank of the solution, below getCount()
+		 * @return The solution enumerate() visits at this position
+		 */
+		MoveSequence getSolution(std::uint64_t index) const;
+
+		/**
+		 * Visit the optimal solutions one after the other, generating each
+		 * only when it is visited
+		 * @param visit Called with each solution, stops the enumeration by returning false
+		 */
+		void enumerate(std::function<bool(MoveSequence const&)> const& visit) const;
+
+		/**
+		 * @return Memory held by the layers in bytes
+		 */
+		std::size_t getMemoryUsage() const;
+	private:
+		typedef std::uint64_t key_t;
+
+		struct Layer {
+			// Sorted
+			std::vector<key_t> keys;
+			// Optimal move sequences from each state to the goal
+			std::vector<std::uint64_t> counts;
+		};
+
+		// Scratch for making moves
+		mutable Map m_map;
+		GoalTest m_goalTest;
+		OptimalSolutionsOptions m_options;
+		Map::State m_start;
+		std::vector<Color> m_robots;
+		unsigned m_flagShift;
+
+		std::vector<Layer> m_layers;
+		unsigned m_length;
+		bool m_limitReached;
+
+		key_t key(Map::State const& state, GoalTest::flags_t flags) const {
+			return m_map.pack(state) | (static_cast<key_t>(flags) << m_flagShift);
+		}
+
+		/**
+		 * Make the moves from a state, in the order of enumeration
+		 * @param k Key of the state
+		 * @param visit Called with each move, whether it completes the goal, and otherwise the key of the state it leads to
+		 */
+		void expand(key_t k, std::function<void(Move const&, bool, key_t)> const& visit) const;
+		// Optimal move sequences from a state of a layer, 0 if it is not in the layer
+		std::uint64_t count(std::size_t depth, key_t k) const;
+		bool enumerate(std::size_t depth, key_t k, MoveSequence& moves, std::function<bool(MoveSequence const&)> const& visit) const;
+	};
+
+}
@@ -0,0 +1,78 @@
+#include "PatternDatabase.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	PatternDatabase::PatternDatabase(Map const& map, Goal const& goal, std::vector<Color> const& robots) : m_map(map) {
+		GoalTest const goalTest(goal);
+		for (auto c: robots) {
+			if (goalTest.isGoalRobot(c)) {
+				m_finishers.push_back({ c, {} });
+			}
+		}
+		if (m_finishers.empty()) {
+			throw std::invalid_argument("PatternDatabase: No robot can complete the goal");
+		}
+
+		// One table per pair, shared by both robots if both can complete the goal
+		for (std::size_t i = 0u; i < robots.size(); i++) {
+			for (std::size_t j = i + 1u; j < robots.size(); j++) {
+				if (!goalTest.isGoalRobot(robots[i]) && !goalTest.isGoalRobot(robots[j])) {
+					continue;
+				}
+				m_tables.emplace_back(map, goal, std::vector<Color>{ robots[i], robots[j] }, EndgameTable::Moves::ANY_STOP);
+				for (auto& finisher: m_finishers) {
+					if (finisher.first == robots[i] || finisher.first == robots[j]) {
+						finisher.second.push_back(m_tables.size() - 1u);
+					}
+				}
+			}
+		}
+		if (robots.size() == 1u) {
+			m_tables.emplace_back(map, goal, robots, EndgameTable::Moves::ANY_STOP);
+			m_finishers.front().second.push_back(0u);
+		}
+	}
+
+	unsigned PatternDatabase::lookup(EndgameTable const& table, Map::State const& state, GoalTest::flags_t flags) const {
+		for (auto c: table.getRobots()) {
+			if (!m_map.posValid(state.robots[toInt(c)])) {
+				// A helper that is not on the board gives no bound
+				return 0u;
+			}
+		}
+		Map::State projected = state;
+		for (auto c: RobotColors) {
+			if (std::find(table.getRobots().cbegin(), table.getRobots().cend(), c) == table.getRobots().cend()) {
+				projected.robots[toInt(c)] = Pos();
+			}
+		}
+		return table.distance(projected, flags);
+	}
+
+	unsigned PatternDatabase::lowerBound(Map::State const& state, GoalTest::flags_t flags) const {
+		unsigned bound = EndgameTable::UNKNOWN;
+		for (auto const& finisher: m_finishers) {
+			if (!m_map.posValid(state.robots[toInt(finisher.first)])) {
+				continue;
+			}
+			unsigned finisherBound = 0u;
+			for (std::size_t t: finisher.second) {
+				finisherBound = std::max(finisherBound, lookup(m_tables[t], state, flags));
+			}
+			bound = std::min(bound, finisherBound);
+		}
+		return bound;
+	}
+
+	std::size_t PatternDatabase::getMemoryUsage() const {
+		std::size_t bytes = 0u;
+		for (auto const& table: m_tables) {
+			bytes += (table.size() + 1u) / 2u;
+		}
+		return bytes;
+	}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "EndgameTable.h"
+#include "Goal.h"
+#include "GoalTest.h"
+#include "Map.h"
+
+#include <utility>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Admissible heuristic built from pattern databases over pairs of
+	 * robots: a robot that can complete the goal and one helper. Each
+	 * pair is an EndgameTable with relaxed moves, in which the removed
+	 * robots may stop a robot anywhere, so its distances never exceed the
+	 * real ones. The helper still blocks rays and counts moves, which
+	 * makes the bound tighter than the one of a lone robot.
+	 * The bound of a state is the largest over the helpers; for MIX goals,
+	 * where any robot may complete the goal, the smallest over the robot
+	 * that completes it.
+	 */
+	class PatternDatabase {
+	public:
+		/**
+		 * Build the tables, one per pair of robots
+		 * @param map Board, robot positions are ignored
+		 * @param goal Goal to reach
+		 * @param robots Robots on the board
+		 */
+		PatternDatabase(Map const& map, Goal const& goal, std::vector<Color> const& robots);
+
+		/**
+		 * @param state State of all robots
+		 * @param flags Ricochet flags of the robots
+		 * @return Lower bound on the number of moves to the goal, EndgameTable::UNKNOWN if the goal
+		 * can not be reached within EndgameTable::MAX_DISTANCE moves
+		 */
+		unsigned lowerBound(Map::State const& state, GoalTest::flags_t flags) const;
+
+		/**
+		 * @return Memory held by the tables in bytes
+		 */
+		std::size_t getMemoryUsage() const;
+	private:
+		Map m_map;
+		std::vector<EndgameTable> m_tables;
+		// For each robot that may complete the goal, the tables containing it
+		std::vector<std::pair<Color, std::vector<std::size_t>>> m_finishers;
+
+		unsigned lookup(EndgameTable const& table, Map::State const& state, GoalTest::flags_t flags) const;
+	};
+
+}
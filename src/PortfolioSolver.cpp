@@ -0,0 +1,131 @@
+#include "PortfolioSolver.h"
+#include "AStarSearch.h"
+#include "BidirectionalSearch.h"
+#include "PatternDatabase.h"
+#include "RobotRelevance.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	namespace {
+		Goal const& currentGoal(Game const& game) {
+			if (!game.getCurrentGoal()) {
+				throw std::invalid_argument("PortfolioSolver: Game has no current goal");
+			}
+			return *game.getCurrentGoal();
+		}
+	}
+
+	PortfolioSolver::PortfolioSolver(Game const& game, PortfolioOptions const& options) :
+			m_map(game.getMap()), m_goal(currentGoal(game)), m_options(options), m_cancelled(false), m_done(false), m_running(0u)
+	{
+	}
+
+	PortfolioSolver::~PortfolioSolver() {
+		join();
+	}
+
+	char const* PortfolioSolver::getName(PortfolioOptions::Strategy strategy) {
+		switch (strategy) {
+			case PortfolioOptions::Strategy::ASTAR:
+				return "astar";
+			case PortfolioOptions::Strategy::ASTAR_PATTERN_DATABASE:
+				return "astar-pdb";
+			case PortfolioOptions::Strategy::BIDIRECTIONAL:
+				return "bidirectional";
+		}
+		return "unknown";
+	}
+
+	PortfolioResult PortfolioSolver::solve() {
+		join();
+		m_cancelled = false;
+		m_done = false;
+		m_running = static_cast<unsigned>(m_options.strategies.size());
+		m_result = { std::nullopt, std::string(), std::chrono::steady_clock::duration::zero() };
+		m_start = std::chrono::steady_clock::now();
+
+		for (auto strategy: m_options.strategies) {
+			m_pool.emplace_back(&PortfolioSolver::run, this, strategy);
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_finished.wait(lock, [this]() {
+			return m_done || m_running == 0u;
+		});
+		m_done = true;
+		return m_result;
+	}
+
+	void PortfolioSolver::run(PortfolioOptions::Strategy strategy) {
+		auto interrupt = [this]() {
+			return m_done || m_cancelled;
+		};
+		switch (strategy) {
+			case PortfolioOptions::Strategy::ASTAR:
+			case PortfolioOptions::Strategy::ASTAR_PATTERN_DATABASE: {
+				AStarOptions options;
+				options.depthLimit = m_options.depthLimit;
+				options.maxStates = m_options.maxStates;
+				options.interrupt = interrupt;
+				std::optional<PatternDatabase> database;
+				if (strategy == PortfolioOptions::Strategy::ASTAR_PATTERN_DATABASE) {
+					std::vector<Color> robots;
+					for (auto c: RobotColors) {
+						if (m_map.posValid(m_map.state().robots[toInt(c)])) {
+							robots.push_back(c);
+						}
+					}
+					database.emplace(m_map, m_goal, robots);
+					options.heuristic = [&database](Map::State const& state, GoalTest::flags_t flags) {
+						return std::max(database->lowerBound(state, flags), 1u);
+					};
+				}
+				AStarSearch search(m_map, m_goal, options);
+				auto solution = search.solve();
+				finish(strategy, std::move(solution), !search.interrupted() && !search.limitReached());
+				break;
+			}
+			case PortfolioOptions::Strategy::BIDIRECTIONAL: {
+				BidirectionalOptions options;
+				options.depthLimit = m_options.depthLimit;
+				// Seeding the goal side grows with every movable robot, so keep the default cap
+				if (m_options.maxStates != 0u) {
+					options.maxStates = m_options.maxStates;
+				}
+				options.robots = RobotRelevance(m_map, m_goal).relevantRobots(m_options.depthLimit);
+				options.pruneRobots = false;
+				options.interrupt = interrupt;
+				BidirectionalSearch search(m_map, m_goal, options);
+				auto solution = search.solve();
+				finish(strategy, std::move(solution), !search.interrupted() && !search.limitReached());
+				break;
+			}
+		}
+	}
+
+	void PortfolioSolver::finish(PortfolioOptions::Strategy strategy, std::optional<MoveSequence>&& solution, bool proven) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_running--;
+			if (proven && !m_done) {
+				m_done = true;
+				m_result.solution = std::move(solution);
+				m_result.strategy = getName(strategy);
+				m_result.elapsed = std::chrono::steady_clock::now() - m_start;
+			}
+		}
+		m_finished.notify_all();
+	}
+
+	void PortfolioSolver::join() {
+		m_done = true;
+		for (auto& thread: m_pool) {
+			thread.join();
+		}
+		m_pool.clear();
+	}
+
+}
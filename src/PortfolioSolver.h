@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Game.h"
+#include "Goal.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ricochet {
+
+	struct PortfolioOptions {
+		enum class Strategy {
+			/// AStarSearch with the distances of the goal robots
+			ASTAR,
+			/// AStarSearch with pattern databases over pairs of robots
+			ASTAR_PATTERN_DATABASE,
+			/// BidirectionalSearch over the robots that RobotRelevance keeps, capped at
+			/// BidirectionalOptions::maxStates unless maxStates is set
+			BIDIRECTIONAL
+		};
+
+		/// Strategies to race, each on its own thread
+		std::vector<Strategy> strategies{ Strategy::ASTAR, Strategy::ASTAR_PATTERN_DATABASE, Strategy::BIDIRECTIONAL };
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 20u;
+		/// States a strategy may hold before it gives up, 0 for no limit except for BIDIRECTIONAL
+		std::size_t maxStates = 0u;
+	};
+
+	struct PortfolioResult {
+		/// Optimal solution, empty if there is none within depthLimit or no strategy finished
+		std::optional<MoveSequence> solution;
+		/// Name of the strategy that finished first, empty if none did
+		std::string strategy;
+		/// Time until the first strategy finished
+		std::chrono::steady_clock::duration elapsed;
+	};
+
+	/**
+	 * Races several optimal solvers on the current goal of a game. The
+	 * first strategy that either finds a solution or proves there is none
+	 * within the depth limit wins; the others are interrupted. A strategy
+	 * that gives up at maxStates proves nothing and does not win.
+	 * solve() returns with the winner, without waiting for the others to
+	 * notice the interruption; they are joined by the next solve() or the
+	 * destructor. The result names the winner so that callers can log it.
+	 */
+	class PortfolioSolver {
+	public:
+		/**
+		 * @param game Game with a current goal
+		 * @param options Strategies and limits
+		 */
+		PortfolioSolver(Game const& game, PortfolioOptions const& options = PortfolioOptions());
+
+		~PortfolioSolver();
+
+		PortfolioSolver(PortfolioSolver const&) = delete;
+		PortfolioSolver& operator=(PortfolioSolver const&) = delete;
+
+		/**
+		 * Run all strategies until one finishes or cancel() is called
+		 * @return Result of the winning strategy
+		 */
+		PortfolioResult solve();
+
+		/**
+		 * Stop the strategies running in solve(), may be called from any thread
+		 */
+		void cancel() {
+			m_cancelled = true;
+		}
+
+		/**
+		 * @param strategy Strategy
+		 * @return Name of the strategy
+		 */
+		static char const* getName(PortfolioOptions::Strategy strategy);
+	private:
+		Map m_map;
+		Goal m_goal;
+		PortfolioOptions m_options;
+		std::atomic<bool> m_cancelled;
+
+		std::vector<std::thread> m_pool;
+		std::mutex m_mutex;
+		std::condition_variable m_finished;
+		// Set once a strategy won, interrupts the others
+		std::atomic<bool> m_done;
+		unsigned m_running;
+		PortfolioResult m_result;
+		std::chrono::steady_clock::time_point m_start;
+
+		void run(PortfolioOptions::Strategy strategy);
+		void finish(PortfolioOptions::Strategy strategy, std::optional<MoveSequence>&& solution, bool proven);
+		void join();
+	};
+
+}
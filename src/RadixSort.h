@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Sort unsigned 64 bit keys with a least significant digit radix sort
+	 * on bytes. Only the lowest keyBits bits are considered, passes in
+	 * which all keys share the same byte are skipped.
+	 * @param keys Keys to sort in place
+	 * @param keyBits Number of significant bits of the keys
+	 * @param buffer Scratch space, as large as keys afterwards. Passing the same one again saves allocating it.
+	 */
+	inline void radixSort(std::vector<std::uint64_t>& keys, unsigned keyBits, std::vector<std::uint64_t>& buffer) {
+		if (keys.size() < 2u) {
+			return;
+		}
+		buffer.resize(keys.size());
+		for (unsigned shift = 0u; shift < keyBits; shift += 8u) {
+			std::array<std::size_t, 256> count{};
+			for (std::uint64_t key: keys) {
+				count[(key >> shift) & 0xFFu]++;
+			}
+			if (count[(keys.front() >> shift) & 0xFFu] == keys.size()) {
+				// All keys have the same digit, order is unchanged
+				continue;
+			}
+
+			std::size_t offset = 0u;
+			for (auto& c: count) {
+				std::size_t const n = c;
+				c = offset;
+				offset += n;
+			}
+			for (std::uint64_t key: keys) {
+				buffer[count[(key >> shift) & 0xFFu]++] = key;
+			}
+			keys.swap(buffer);
+		}
+	}
+
+	/**
+	 * Sort unsigned 64 bit keys with a least significant digit radix sort
+	 * on bytes, see above
+	 * @param keys Keys to sort in place
+	 * @param keyBits Number of significant bits of the keys
+	 */
+	inline void radixSort(std::vector<std::uint64_t>& keys, unsigned keyBits = 64u) {
+		std::vector<std::uint64_t> buffer;
+		radixSort(keys, keyBits, buffer);
+	}
+
+	/**
+	 * Remove all keys of a sorted range from a sorted vector of keys
+	 * @param keys Sorted keys, reduced in place
+	 * @param begin Start of the sorted keys to remove
+	 * @param end End of the sorted keys to remove
+	 */
+	template<typename Iter>
+	void subtractSorted(std::vector<std::uint64_t>& keys, Iter begin, Iter end) {
+		auto out = keys.begin();
+		for (auto it = keys.begin(); it != keys.end(); ++it) {
+			while (begin != end && *begin < *it) {
+				++begin;
+			}
+			if (begin == end || *begin != *it) {
+				*out++ = *it;
+			}
+		}
+		keys.erase(out, keys.end());
+	}
+
+}
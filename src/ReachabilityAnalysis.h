@@ -1,148 +1,765 @@
 #pragma once
 
+#include "BinaryFile.h"
+#include "KeyFile.h"
 #include "Map.h"
+#include "MoveSequence.h"
+#include "RadixSort.h"
+#include "StateIndex.h"
+#include "SymbolicReachability.h"
 #include "l3pp.h"
 
-#include <map>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <numeric>
 #include <optional>
 #include <queue>
-#include <unordered_set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
 
 namespace ricochet {
-	struct reachable {
-		reachable() : next{0} {};
-		std::array<std::uint64_t, 20> next;
+	enum class SearchStatus {
+		/// The reachable state space was explored completely
+		COMPLETE,
+		/// States at the depth limit were not expanded
+		DEPTH_LIMITED,
+		/// The search was aborted after exceeding its memory limit
+		MEMORY_LIMITED,
 	};
 
-	struct MoveWithHistory {
-		Color color;
-		Direction dir;
+	struct DfsOptions {
+		/// States at this depth are not expanded further, 0 for no limit
+		std::size_t depthLimit = 0u;
+		/// Approximate limit for the memory used by the search in bytes, 0 for no limit
+		std::size_t memoryLimit = 0u;
+		/// Log progress each time this many new states were found, 0 to disable
+		std::size_t progressInterval = 10000000u;
+	};
+
+	struct DfsFrame {
 		Map::State state;
-		std::size_t depth;
-		std::optional<std::size_t> priorMoveIndex;
+		std::uint8_t nextMove;
+	};
+
+	struct HistogramEstimateOptions {
+		/// Number of layers before the one being expanded kept for duplicate detection, SIZE_MAX to keep all
+		std::size_t previousLayers = 2u;
+		/// States at this depth are not expanded further, 0 for no limit. Required unless all layers are kept.
+		std::size_t depthLimit = 20u;
+	};
+
+	struct BitstateOptions {
+		/// Size of the visited bit array, rounded up to a power of two
+		std::size_t bits = std::size_t(1u) << 30u;
+		/// Number of bits set per state
+		unsigned hashes = 3u;
+		/// States at this depth are not expanded further, 0 for no limit
+		std::size_t depthLimit = 0u;
+	};
+
+	struct ExternalBfsOptions {
+		/// Directory holding the layer and run files, created if missing
+		std::string directory = "bfs-data";
+		/**
+		 * Memory for the states of a layer, in bytes, apart from the fixed
+		 * buffers of the files being written. A third buffers generated
+		 * states before they are sorted and spilled to disk, a third is the
+		 * scratch space of the sort, and the rest holds the chunk of the
+		 * layer being expanded and its successors. Merging reads the runs
+		 * and layers through buffers of a third in all.
+		 */
+		std::size_t memoryLimit = std::size_t(1u) << 30u;
+		/// Number of threads expanding each chunk of a layer
+		unsigned threads = 1u;
+		/// Continue from the last complete layer found in the directory
+		bool resume = true;
+		/// Keep the layer files after the search finished
+		bool keepFiles = false;
+	};
+
+	struct CheckpointOptions {
+		/// File receiving the checkpoints, empty to disable checkpointing
+		std::string file;
+		/// Minimum time between two checkpoints in seconds
+		double intervalSeconds = 600.0;
+		/// Continue from the checkpoint file if it exists
+		bool resume = true;
 	};
 
 	class ReachabilityAnalysis {
 	public:
-		void bfs(ricochet::Map& map) {
+		ReachabilityAnalysis() : numTrans(0u), maxDepth(0u), nodeIndex(nodes), bitstateOmissions(0.0) {}
+
+		// The node index refers to the node array of this instance
+		ReachabilityAnalysis(ReachabilityAnalysis const&) = delete;
+		ReachabilityAnalysis& operator=(ReachabilityAnalysis const&) = delete;
+
+		/**
+		 * Explore all states reachable from the current map state in breadth
+		 * first order. Each discovered state is kept as packed state together
+		 * with the index of its parent and the move leading to it, so that
+		 * the path to any discovered state can be reconstructed afterwards.
+		 * With checkpointing enabled, the search state is periodically saved
+		 * and a later call with the same options continues from there.
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param checkpoint Where and how often to save the search state
+		 */
+		void bfs(ricochet::Map& map, CheckpointOptions const& checkpoint = CheckpointOptions()) {
 			map.push();
 
-			moves.clear();
-			moves.reserve(10000000);
-			while (!queue.empty()) {
-				queue.pop();
-			}
-			knownMaps.clear();
+			nodes.clear();
+			parents.clear();
+			nodeMoves.clear();
+			layerStart.clear();
+			nodeIndex.clear();
 			numTrans = 0u;
 
-			queue.push(moves.size());
-			moves.push_back({ Color::BLUE, Direction::NORTH, map.state(), 0u });
-			knownMaps.insert(map.state());
+			// Nodes are appended in BFS order, so each layer is a contiguous range
+			std::size_t index = 0u;
+			std::size_t layerEnd = 1u;
+			if (resumeCheckpoint(checkpoint)) {
+				loadBfsCheckpoint(map, checkpoint.file, index, layerEnd);
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "BFS - Resuming from checkpoint with " << nodes.size() << " states, " << index << " expanded");
+			} else {
+				nodes.push_back(map.pack(map.state()));
+				parents.push_back(0u);
+				nodeMoves.push_back(0u);
+				nodeIndex.insert(0u);
+				layerStart.push_back(0u);
+			}
 
-			maxDepth = 0u;
-			std::size_t numberOfNodesMissingInDfs = 0u;
-			while (!queue.empty()) {
-				std::size_t const index = queue.front();
-				queue.pop();
-				/*
-				if (states.find(moves[index].hash) == states.cend()) {
-					//L3PP_LOG_ERROR(l3pp::getRootLogger(), "BFS - State with hash " << std::hex << moves[index].hash << " was not visited by DFS!");
-					++numberOfNodesMissingInDfs;
-					std::vector<MoveWithHistory> pathTaken;
-					MoveWithHistory currentMove = moves[index];
-					while (true) {
-						pathTaken.push_back(currentMove);
-						if (!currentMove.priorMoveIndex) {
-							break;
+			CheckpointTimer timer(checkpoint);
+			for (; index < nodes.size(); index++) {
+				if (timer.due()) {
+					saveBfsCheckpoint(map, checkpoint.file, index, layerEnd);
+					L3PP_LOG_INFO(l3pp::getRootLogger(), "BFS - Checkpoint with " << nodes.size() << " states, " << index << " expanded");
+				}
+				if (index == layerEnd) {
+					// All nodes of the next layer are known once the current one is expanded
+					layerStart.push_back(index);
+					layerEnd = nodes.size();
+				}
+				Map::State const state = map.unpack(nodes[index]);
+
+				for (ricochet::Color c : ricochet::RobotColors) {
+					for (ricochet::Direction dir : ricochet::AllDirections) {
+						map.loadState(state);
+						Move const move{ c, dir };
+						if (map.moveRobot(c, dir)) {
+							++numTrans;
+
+							nodes.push_back(map.pack(map.state()));
+							if (nodeIndex.insert(nodes.size() - 1u).second) {
+								parents.push_back(static_cast<StateIndex::index_t>(index));
+								nodeMoves.push_back(encodeMove(move));
+							} else {
+								nodes.pop_back();
+							}
 						}
-						currentMove = moves[*currentMove.priorMoveIndex];
 					}
+				}
+			}
+			maxDepth = layerStart.size() - 1u;
+			depthHistogram.clear();
+			for (std::size_t depth = 0u; depth <= maxDepth; depth++) {
+				std::size_t const end = (depth == maxDepth) ? nodes.size() : layerStart[depth + 1u];
+				depthHistogram.push_back(end - layerStart[depth]);
+			}
+
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "BFS - States: " << nodes.size() << ", Transitions: " << numTrans << ", ~" << (getBfsMemoryUsage() >> 20u) << " MiB");
+			removeCheckpoint(checkpoint);
+			map.pop();
+		}
+
+		/**
+		 * Estimate the depth histogram from above, keeping only the last few
+		 * BFS layers in memory instead of all visited states. This is not a
+		 * counting mode: moves can not be undone in general, so a state may
+		 * be reached again from a layer further back than
+		 * options.previousLayers, and is then counted and expanded a second
+		 * time. Each entry of the histogram is an upper bound on the states
+		 * first reached at that depth, and on real boards states keep coming
+		 * back without end, so a depth limit is required. Count states and
+		 * depths exactly with bfsSorted() or bfsExternal().
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param options Number of layers kept and depth limit
+		 * @return COMPLETE if the search ran out of states it did not recognize
+		 */
+		SearchStatus estimateDepthHistogram(ricochet::Map& map, HistogramEstimateOptions const& options = HistogramEstimateOptions()) {
+			if (options.depthLimit == 0u && options.previousLayers != SIZE_MAX) {
+				throw std::invalid_argument("estimateDepthHistogram: A depth limit is required unless all layers are kept");
+			}
+			map.push();
+
+			numTrans = 0u;
+			depthHistogram.clear();
+
+			// The last layer is the one being expanded
+			std::deque<PackedStateSet> layers(1u);
+			layers.back().insert(map.pack(map.state()));
+			depthHistogram.push_back(1u);
+
+			SearchStatus status = SearchStatus::COMPLETE;
+			while (true) {
+				if (options.depthLimit != 0u && depthHistogram.size() > options.depthLimit) {
+					status = SearchStatus::DEPTH_LIMITED;
+					break;
+				}
+
+				PackedStateSet next;
+				layers.back().forEach([&](Map::PackedState key) {
+					Map::State const state = map.unpack(key);
+					for (ricochet::Color c : ricochet::RobotColors) {
+						for (ricochet::Direction dir : ricochet::AllDirections) {
+							map.loadState(state);
+							if (map.moveRobot(c, dir)) {
+								++numTrans;
 
-					auto it = pathTaken.rbegin();
-					auto const end = pathTaken.rend();
-					int depthError = 0;
-					for (; it != end; ++it) {
-						depthError++;
-						auto res = states.find(it->hash);
-						if (res != states.end()) {
-							Color const c = (it + 1)->color;
-							Direction const d = (it + 1)->dir;
-							std::size_t const offset = (static_cast<unsigned>(c) << 2) | (static_cast<unsigned>(d));
-							ricochet::Map::hash_t nextHashDfs = res->second.next[offset];
-							if (nextHashDfs != (it + 1)->hash) {
-								L3PP_LOG_ERROR(l3pp::getRootLogger(), "BFS - Path mistake at depth " << depthError << ".");
-								break;
+								Map::PackedState const child = map.pack(map.state());
+								bool const known = std::any_of(layers.cbegin(), layers.cend(), [child](PackedStateSet const& layer) {
+									return layer.contains(child);
+								});
+								if (!known) {
+									next.insert(child);
+								}
 							}
-						} else {
-							L3PP_LOG_ERROR(l3pp::getRootLogger(), "BFS - Could not traverse path not visited by DFS!");
-							break;
 						}
 					}
-				}*/
+				});
+				if (next.empty()) {
+					break;
+				}
 
-				for (ricochet::Color c : ricochet::RobotColors) {
-					for (ricochet::Direction dir : ricochet::AllDirections) {
-						map.loadState(moves[index].state);
-						if (map.moveRobot(c, dir)) {
-							++numTrans;
+				depthHistogram.push_back(next.size());
+				layers.push_back(std::move(next));
+				while (layers.size() - 1u > options.previousLayers) {
+					layers.pop_front();
+				}
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "Histogram estimate - Depth " << (depthHistogram.size() - 1u) << ": at most " << depthHistogram.back() << " states");
+			}
+			maxDepth = depthHistogram.size() - 1u;
+
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "Histogram estimate - States: at most " << std::accumulate(depthHistogram.cbegin(), depthHistogram.cend(), static_cast<std::size_t>(0u)) << ", Transitions: " << numTrans);
+			map.pop();
+			return status;
+		}
+
+		/**
+		 * Count the states reachable from the current map state per depth
+		 * with a visited set of fixed size (bitstate hashing): each state
+		 * sets options.hashes bits of a bit array, derived from its Zobrist
+		 * hash, and counts as visited if all of them were set before. Only
+		 * the layer being expanded and the next one are kept as states.
+		 * Different states may set the same bits, so some new states are
+		 * taken for visited and neither counted nor expanded, making the
+		 * histogram a lower bound. getBitstateOmissionEstimate() gives the
+		 * expected number of such states from the fill of the bit array,
+		 * not counting the states only reachable through them.
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param options Size of the bit array, number of hashes and depth limit
+		 * @return COMPLETE if the search ran out of new states
+		 */
+		SearchStatus bfsBitstate(ricochet::Map& map, BitstateOptions const& options = BitstateOptions()) {
+			map.push();
 
-							if (knownMaps.find(map.state()) == knownMaps.cend()) {
-								knownMaps.insert(map.state());
-								queue.push(moves.size());
-								std::size_t depth = moves[index].depth + 1u;
-								maxDepth = std::max(maxDepth, depth);
-								moves.push_back({ c, dir, map.state(), depth, index });
+			numTrans = 0u;
+			depthHistogram.clear();
+			bitstateOmissions = 0.0;
+
+			std::size_t bits = 64u;
+			while (bits < options.bits) {
+				bits <<= 1u;
+			}
+			std::size_t const mask = bits - 1u;
+			std::vector<std::uint64_t> visited(bits / 64u, 0u);
+			std::size_t setBits = 0u;
+			unsigned const hashes = std::max(1u, options.hashes);
+
+			// Set the bits of a state by double hashing, true if one was not set before
+			auto insert = [&](Map::hash_t hash) {
+				std::uint64_t const h1 = static_cast<std::uint64_t>(hash);
+				std::uint64_t h2 = h1 * 0x9E3779B97F4A7C15ull;
+				h2 = (h2 ^ (h2 >> 32u)) | 1u;
+				bool fresh = false;
+				for (unsigned i = 0u; i < hashes; i++) {
+					std::size_t const bit = static_cast<std::size_t>(h1 + i * h2) & mask;
+					std::uint64_t const flag = static_cast<std::uint64_t>(1u) << (bit % 64u);
+					if ((visited[bit / 64u] & flag) == 0u) {
+						visited[bit / 64u] |= flag;
+						setBits++;
+						fresh = true;
+					}
+				}
+				return fresh;
+			};
+
+			std::vector<Map::PackedState> layer{ map.pack(map.state()) };
+			insert(map.state().hash);
+			depthHistogram.push_back(1u);
+
+			SearchStatus status = SearchStatus::COMPLETE;
+			std::vector<Map::PackedState> next;
+			while (true) {
+				if (options.depthLimit != 0u && depthHistogram.size() > options.depthLimit) {
+					status = SearchStatus::DEPTH_LIMITED;
+					break;
+				}
+
+				next.clear();
+				for (Map::PackedState const key: layer) {
+					Map::State const state = map.unpack(key);
+					for (ricochet::Color c : ricochet::RobotColors) {
+						for (ricochet::Direction dir : ricochet::AllDirections) {
+							map.loadState(state);
+							if (map.moveRobot(c, dir)) {
+								++numTrans;
+
+								// Chance that a new state finds all its bits set already
+								double const collision = std::min(std::pow(static_cast<double>(setBits) / static_cast<double>(bits), static_cast<double>(hashes)), 0.999);
+								if (insert(map.state().hash)) {
+									next.push_back(map.pack(map.state()));
+									bitstateOmissions += collision / (1.0 - collision);
+								}
 							}
 						}
 					}
 				}
+				if (next.empty()) {
+					break;
+				}
+
+				depthHistogram.push_back(next.size());
+				layer.swap(next);
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "Bitstate BFS - Depth " << (depthHistogram.size() - 1u) << ": " << depthHistogram.back() << " states, " << setBits << " of " << bits << " bits set");
 			}
+			maxDepth = depthHistogram.size() - 1u;
 
-			L3PP_LOG_INFO(l3pp::getRootLogger(), "BFS - States: " << knownMaps.size() << ", Transitions: " << numTrans);
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "Bitstate BFS - States: " << std::accumulate(depthHistogram.cbegin(), depthHistogram.cend(), static_cast<std::size_t>(0u)) << ", Transitions: " << numTrans << ", ~" << static_cast<std::size_t>(bitstateOmissions) << " states estimated missed");
 			map.pop();
+			return status;
+		}
 
-			if (numberOfNodesMissingInDfs > 0u) {
-				L3PP_LOG_ERROR(l3pp::getRootLogger(), "BFS - " << numberOfNodesMissingInDfs << " states were not visited by DFS!");
+		/**
+		 * @return Expected number of new states the last bitstate BFS took for visited
+		 */
+		double getBitstateOmissionEstimate() const {
+			return bitstateOmissions;
+		}
+
+		/**
+		 * Count the states reachable from the current map state per depth
+		 * with SymbolicReachability, holding the layers as binary decision
+		 * diagrams. Gives the same depth histogram as bfs(); transitions are
+		 * not counted.
+		 * @param map Map to explore, its state is not changed
+		 * @param depthLimit Deepest layer to compute, 0 for no limit
+		 * @return COMPLETE if the search ran out of new states
+		 */
+		SearchStatus bfsSymbolic(ricochet::Map const& map, std::size_t depthLimit = 0u) {
+			numTrans = 0u;
+			SymbolicReachability symbolic(map);
+			SearchStatus status = SearchStatus::COMPLETE;
+			while (true) {
+				if (depthLimit != 0u && symbolic.getDepthHistogram().size() > depthLimit) {
+					status = SearchStatus::DEPTH_LIMITED;
+					break;
+				}
+				if (!symbolic.step()) {
+					break;
+				}
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "Symbolic BFS - Depth " << (symbolic.getDepthHistogram().size() - 1u) << ": " << symbolic.getDepthHistogram().back() << " states in " << symbolic.getFrontierNodes() << " nodes, " << (symbolic.getMemoryUsage() >> 20u) << " MiB");
 			}
+			depthHistogram = symbolic.getDepthHistogram();
+			maxDepth = depthHistogram.size() - 1u;
+
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "Symbolic BFS - States: " << std::accumulate(depthHistogram.cbegin(), depthHistogram.cend(), static_cast<std::size_t>(0u)));
+			return status;
 		}
 
-		void dfs(ricochet::Map& map) {
+		/**
+		 * Explore all states reachable from the current map state in breadth
+		 * first order with delayed duplicate detection: each layer is
+		 * generated into a flat array of packed states, radix sorted, made
+		 * unique and then reduced by merging against the previous layers.
+		 * Gives the same counts and depth histogram as bfs().
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param threads Number of threads expanding each layer
+		 */
+		void bfsSorted(ricochet::Map& map, unsigned threads = 1u) {
 			map.push();
 
-			states.clear();
-			auto res = states.insert(std::make_pair(map.state(), reachable()));
 			numTrans = 0u;
-			depth = 0u;
-			maxDepth = 0u;
-			dfs(map, res.first);
-			L3PP_LOG_INFO(l3pp::getRootLogger(), "DFS - States: " << states.size() << ", Transitions: " << numTrans);
+			depthHistogram.clear();
+
+			unsigned const keyBits = map.getPackedBitsPerRobot() * RICOCHET_ROBOTS_MAX_ROBOT_COUNT;
+			std::vector<std::vector<Map::PackedState>> layers;
+			layers.push_back({ map.pack(map.state()) });
+			depthHistogram.push_back(1u);
+			while (true) {
+				std::vector<Map::PackedState> next = expandLayer(map, layers.back().cbegin(), layers.back().cend(), threads);
+				radixSort(next, keyBits);
+				next.erase(std::unique(next.begin(), next.end()), next.end());
+				for (auto it = layers.crbegin(); it != layers.crend() && !next.empty(); ++it) {
+					subtractSorted(next, it->cbegin(), it->cend());
+				}
+				if (next.empty()) {
+					break;
+				}
 
+				depthHistogram.push_back(next.size());
+				layers.push_back(std::move(next));
+			}
+			maxDepth = depthHistogram.size() - 1u;
+
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "Sorted BFS - States: " << std::accumulate(depthHistogram.cbegin(), depthHistogram.cend(), static_cast<std::size_t>(0u)) << ", Transitions: " << numTrans);
 			map.pop();
 		}
 
-		void dfs(ricochet::Map& map, std::unordered_map<Map::State, reachable>::iterator const& it) {
-			++depth;
-			maxDepth = std::max(maxDepth, depth);
-			auto stateIndex = map.push();
-			size_t moveI = 0;
-			for(ricochet::Color c: ricochet::RobotColors) {
-				for(ricochet::Direction dir: ricochet::AllDirections) {
-					if (map.moveRobot(c, dir)) {
-						numTrans++;
-						auto res = states.insert(std::make_pair(map.state(), reachable()));
-						//it->second.next[moveI] = map.state().hash;
-						if (res.second) {
-							// new item, recurse
-							dfs(map, res.first);
+		/**
+		 * Explore all states reachable from the current map state in breadth
+		 * first order, keeping the layers on disk. The successors of a layer
+		 * are generated in memory sized chunks, each sorted and written as a
+		 * run. The runs are then merged, removing duplicates and the states of
+		 * all previous layers, into the file of the next layer. All files are
+		 * read and written sequentially in large blocks.
+		 * After each layer a progress file is written, so an interrupted
+		 * search can be resumed from the last complete layer.
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param options Location of the files, memory budget and resume behaviour
+		 */
+		void bfsExternal(ricochet::Map& map, ExternalBfsOptions const& options = ExternalBfsOptions()) {
+			namespace fs = std::filesystem;
+			map.push();
+
+			fs::create_directories(options.directory);
+			auto const layerFile = [&options](std::size_t depth) {
+				return (fs::path(options.directory) / ("layer-" + std::to_string(depth) + ".bin")).string();
+			};
+			auto const runFile = [&options](std::size_t run) {
+				return (fs::path(options.directory) / ("run-" + std::to_string(run) + ".bin")).string();
+			};
+			std::string const progressFile = (fs::path(options.directory) / "progress.bin").string();
+
+			IoStats io;
+			ExternalBfsProgress progress;
+			progress.fingerprint = map.fingerprint();
+			progress.root = map.pack(map.state());
+			progress.done = false;
+			progress.transitions = 0u;
+			if (options.resume && fs::exists(progressFile)) {
+				ExternalBfsProgress const stored = readExternalBfsProgress(progressFile);
+				if (stored.fingerprint != progress.fingerprint || stored.root != progress.root) {
+					throw std::runtime_error("bfsExternal: Progress file belongs to a different map or start state");
+				}
+				progress = stored;
+				// Runs of the interrupted layer are generated again
+				for (auto const& entry: fs::directory_iterator(options.directory)) {
+					if (entry.path().filename().string().rfind("run-", 0u) == 0u) {
+						fs::remove(entry.path());
+					}
+				}
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "External BFS - Resuming after depth " << (progress.histogram.size() - 1u));
+			} else {
+				KeyFileWriter writer(layerFile(0u), io);
+				writer.write(progress.root);
+				writer.close();
+				progress.histogram.push_back(1u);
+				writeExternalBfsProgress(progressFile, progress);
+			}
+
+			unsigned const keyBits = map.getPackedBitsPerRobot() * RICOCHET_ROBOTS_MAX_ROBOT_COUNT;
+			std::size_t const bufferKeys = std::max<std::size_t>(options.memoryLimit / (3u * sizeof(Map::PackedState)), 1024u);
+			// Each state has at most one successor per robot and direction,
+			// held twice while the results of the threads are joined
+			std::size_t const chunkKeys = std::max<std::size_t>(bufferKeys / (2u * RobotColors.size() * AllDirections.size() + 1u), 1u);
+			std::vector<Map::PackedState> buffer;
+			std::vector<Map::PackedState> scratch;
+			buffer.reserve(bufferKeys);
+			scratch.reserve(bufferKeys);
+			while (!progress.done) {
+				std::size_t const depth = progress.histogram.size() - 1u;
+				IoStats const ioBefore = io;
+
+				// Expand the current layer into sorted, unique runs
+				std::size_t runs = 0u;
+				std::vector<Map::PackedState> chunk;
+				auto const spill = [&]() {
+					radixSort(buffer, keyBits, scratch);
+					buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+					KeyFileWriter writer(runFile(runs++), io);
+					for (Map::PackedState key: buffer) {
+						writer.write(key);
+					}
+					writer.close();
+					buffer.clear();
+				};
+				{
+					KeyFileReader reader(layerFile(depth), io, chunkKeys);
+					while (!reader.done()) {
+						reader.read(chunk, chunkKeys);
+						std::size_t const before = numTrans;
+						numTrans = 0u;
+						std::vector<Map::PackedState> const next = expandLayer(map, chunk.cbegin(), chunk.cend(), options.threads);
+						progress.transitions += numTrans;
+						numTrans = before;
+						// Never beyond the reserved size
+						if (buffer.size() + next.size() > bufferKeys) {
+							spill();
 						}
-						map.restore(stateIndex);
+						buffer.insert(buffer.end(), next.cbegin(), next.cend());
+					}
+				}
+				if (!buffer.empty() || runs == 0u) {
+					spill();
+				}
+
+				// Merge the runs and subtract all previous layers
+				std::vector<std::unique_ptr<KeyFileReader>> runReaders;
+				std::size_t const readerKeys = std::max<std::size_t>(bufferKeys / (runs + depth + 2u), 1024u);
+				for (std::size_t run = 0u; run < runs; run++) {
+					runReaders.push_back(std::make_unique<KeyFileReader>(runFile(run), io, readerKeys));
+				}
+				std::vector<std::unique_ptr<KeyFileReader>> layerReaders;
+				for (std::size_t d = 0u; d <= depth; d++) {
+					layerReaders.push_back(std::make_unique<KeyFileReader>(layerFile(d), io, readerKeys));
+				}
+				typedef std::pair<Map::PackedState, std::size_t> HeapEntry;
+				std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+				for (std::size_t run = 0u; run < runs; run++) {
+					if (!runReaders[run]->done()) {
+						heap.emplace(runReaders[run]->peek(), run);
 					}
-					moveI++;
 				}
+
+				KeyFileWriter writer(layerFile(depth + 1u), io);
+				bool hasLast = false;
+				Map::PackedState last = 0u;
+				while (!heap.empty()) {
+					auto const [key, run] = heap.top();
+					heap.pop();
+					runReaders[run]->advance();
+					if (!runReaders[run]->done()) {
+						heap.emplace(runReaders[run]->peek(), run);
+					}
+					if (hasLast && key == last) {
+						continue;
+					}
+					hasLast = true;
+					last = key;
+
+					bool known = false;
+					for (auto& layer: layerReaders) {
+						while (!layer->done() && layer->peek() < key) {
+							layer->advance();
+						}
+						if (!layer->done() && layer->peek() == key) {
+							known = true;
+							break;
+						}
+					}
+					if (!known) {
+						writer.write(key);
+					}
+				}
+				writer.close();
+				runReaders.clear();
+				layerReaders.clear();
+				for (std::size_t run = 0u; run < runs; run++) {
+					fs::remove(runFile(run));
+				}
+
+				if (writer.count() == 0u) {
+					fs::remove(layerFile(depth + 1u));
+					progress.done = true;
+				} else {
+					progress.histogram.push_back(writer.count());
+				}
+				writeExternalBfsProgress(progressFile, progress);
+
+				IoStats layerIo;
+				layerIo.bytesRead = io.bytesRead - ioBefore.bytesRead;
+				layerIo.bytesWritten = io.bytesWritten - ioBefore.bytesWritten;
+				layerIo.seconds = io.seconds - ioBefore.seconds;
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "External BFS - Depth " << (depth + 1u) << ": " << writer.count() << " states, " << runs << " runs, read " << (layerIo.bytesRead >> 20u) << " MiB, wrote " << (layerIo.bytesWritten >> 20u) << " MiB, " << layerIo.throughput() << " MiB/s");
+			}
+
+			numTrans = progress.transitions;
+			depthHistogram = progress.histogram;
+			maxDepth = depthHistogram.size() - 1u;
+			if (!options.keepFiles) {
+				for (std::size_t d = 0u; d <= maxDepth; d++) {
+					fs::remove(layerFile(d));
+				}
+				fs::remove(progressFile);
 			}
-			map.pop(false);
-			--depth;
+
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "External BFS - States: " << std::accumulate(depthHistogram.cbegin(), depthHistogram.cend(), static_cast<std::size_t>(0u)) << ", Transitions: " << numTrans << ", I/O: " << ((io.bytesRead + io.bytesWritten) >> 20u) << " MiB at " << io.throughput() << " MiB/s");
+			map.pop();
+		}
+
+		/**
+		 * Number of states first found at each depth by the last bfs(),
+		 * bfsSorted(), bfsExternal() or bfsSymbolic() run, or upper bounds on
+		 * them after estimateDepthHistogram()
+		 * @return States per depth, starting with the initial state at depth 0
+		 */
+		std::vector<std::size_t> const& getDepthHistogram() const {
+			return depthHistogram;
+		}
+
+		/**
+		 * @return Number of distinct states discovered by the last BFS
+		 */
+		std::size_t getNumberOfStates() const {
+			return nodes.size();
+		}
+
+		/**
+		 * Look up a state discovered by the last BFS
+		 * @param map Map the BFS was run on
+		 * @param state State to look up
+		 * @return Index of the node holding the state, if discovered
+		 */
+		std::optional<std::size_t> findState(ricochet::Map const& map, Map::State const& state) const {
+			auto const res = nodeIndex.find(map.pack(state));
+			if (res) {
+				return *res;
+			}
+			return std::nullopt;
+		}
+
+		/**
+		 * Number of moves needed to reach a node of the last BFS
+		 * @param node Index of the node
+		 * @return BFS depth of the node
+		 */
+		std::size_t getDepth(std::size_t node) const {
+			return static_cast<std::size_t>(std::upper_bound(layerStart.cbegin(), layerStart.cend(), node) - layerStart.cbegin()) - 1u;
+		}
+
+		/**
+		 * Reconstruct a shortest move sequence from the start state of the
+		 * last BFS to one of its nodes
+		 * @param node Index of the node
+		 * @return Moves leading to the node
+		 */
+		MoveSequence getPath(std::size_t node) const {
+			MoveSequence path;
+			path.reserve(getDepth(node));
+			while (node != 0u) {
+				path.push_back(decodeMove(nodeMoves[node]));
+				node = parents[node];
+			}
+			std::reverse(path.begin(), path.end());
+			return path;
+		}
+
+		/**
+		 * @return Memory held by the BFS node storage in bytes
+		 */
+		std::size_t getBfsMemoryUsage() const {
+			return nodes.capacity() * sizeof(Map::PackedState) + parents.capacity() * sizeof(StateIndex::index_t) + nodeMoves.capacity() * sizeof(std::uint8_t) + nodeIndex.getMemoryUsage();
+		}
+
+		/**
+		 * Explore all states reachable from the current map state in depth
+		 * first order. Uses an explicit stack instead of recursion, so the
+		 * search depth is not bounded by the size of the call stack.
+		 * With checkpointing enabled, the search state is periodically saved
+		 * and a later call with the same options continues from there.
+		 * @param map Map to explore, its state is restored afterwards
+		 * @param options Depth and memory limits of the search
+		 * @param checkpoint Where and how often to save the search state
+		 * @return COMPLETE if the reachable set was fully explored
+		 */
+		SearchStatus dfs(ricochet::Map& map, DfsOptions const& options = DfsOptions(), CheckpointOptions const& checkpoint = CheckpointOptions()) {
+			map.push();
+
+			states.clear();
+			stack.clear();
+			numTrans = 0u;
+			maxDepth = 0u;
+
+			SearchStatus status = SearchStatus::COMPLETE;
+			if (resumeCheckpoint(checkpoint)) {
+				status = loadDfsCheckpoint(map, checkpoint.file);
+				L3PP_LOG_INFO(l3pp::getRootLogger(), "DFS - Resuming from checkpoint with " << states.size() << " states, stack depth " << stack.size());
+			} else {
+				states.insert(std::make_pair(map.state(), 0u));
+				stack.push_back({ map.state(), 0u });
+			}
+			std::size_t nextProgress = states.size() + options.progressInterval;
+			CheckpointTimer timer(checkpoint);
+			while (!stack.empty()) {
+				if (timer.due()) {
+					saveDfsCheckpoint(map, checkpoint.file, status);
+					L3PP_LOG_INFO(l3pp::getRootLogger(), "DFS - Checkpoint with " << states.size() << " states, stack depth " << stack.size());
+				}
+				DfsFrame& frame = stack.back();
+				if (frame.nextMove == RobotColors.size() * AllDirections.size()) {
+					stack.pop_back();
+					continue;
+				}
+
+				std::size_t const moveIndex = frame.nextMove++;
+				ricochet::Color const c = RobotColors[moveIndex / AllDirections.size()];
+				ricochet::Direction dir = AllDirections[moveIndex % AllDirections.size()];
+				map.loadState(frame.state);
+				if (!map.moveRobot(c, dir)) {
+					continue;
+				}
+				numTrans++;
+
+				// Depth of the new state, the root has depth 0
+				std::size_t const childDepth = stack.size();
+				auto res = states.insert(std::make_pair(map.state(), childDepth));
+				if (!res.second) {
+					// With a depth limit, a state first seen deep in the tree has
+					// to be expanded again if it is found on a shorter path
+					if (options.depthLimit == 0u || res.first->second <= childDepth) {
+						continue;
+					}
+					res.first->second = childDepth;
+				}
+				maxDepth = std::max(maxDepth, childDepth);
+
+				if (options.depthLimit != 0u && childDepth >= options.depthLimit) {
+					status = SearchStatus::DEPTH_LIMITED;
+					continue;
+				}
+
+				if (options.memoryLimit != 0u && getDfsMemoryUsage() > options.memoryLimit) {
+					L3PP_LOG_ERROR(l3pp::getRootLogger(), "DFS - Memory limit of " << options.memoryLimit << " bytes reached, aborting.");
+					status = SearchStatus::MEMORY_LIMITED;
+					break;
+				}
+
+				if (options.progressInterval != 0u && states.size() >= nextProgress) {
+					L3PP_LOG_INFO(l3pp::getRootLogger(), "DFS - Progress: " << states.size() << " states, " << numTrans << " transitions, stack depth " << stack.size() << ", ~" << (getDfsMemoryUsage() >> 20u) << " MiB.");
+					nextProgress += options.progressInterval;
+				}
+
+				stack.push_back({ map.state(), 0u });
+			}
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "DFS - States: " << states.size() << ", Transitions: " << numTrans);
+			if (status != SearchStatus::MEMORY_LIMITED) {
+				removeCheckpoint(checkpoint);
+			}
+
+			stack.clear();
+			stack.shrink_to_fit();
+			map.pop();
+			return status;
 		}
 
 		std::size_t getNumberOfExploredStates() const {
@@ -152,16 +769,262 @@ namespace ricochet {
 		std::size_t getMaxEncounteredDepth() const {
 			return maxDepth;
 		}
+
+		/**
+		 * Estimate the memory held by the DFS visited set and stack
+		 * @return Approximate size in bytes
+		 */
+		std::size_t getDfsMemoryUsage() const {
+			// Each node of the unordered_map holds the value and a next pointer,
+			// plus one bucket pointer per bucket
+			std::size_t const nodeSize = sizeof(std::pair<Map::State const, std::size_t>) + sizeof(void*);
+			return states.size() * nodeSize + states.bucket_count() * sizeof(void*) + stack.capacity() * sizeof(DfsFrame);
+		}
 	private:
-		std::unordered_map<Map::State, reachable> states;
+		// DFS, maps each visited state to the smallest depth it was found at
+		std::unordered_map<Map::State, std::size_t> states;
+		std::vector<DfsFrame> stack;
 		std::size_t numTrans;
-		std::size_t depth;
 		std::size_t maxDepth;
+		// BFS, the nodes in the order they were discovered
+		std::vector<Map::PackedState> nodes;
+		std::vector<StateIndex::index_t> parents;
+		std::vector<std::uint8_t> nodeMoves;
+		std::vector<std::size_t> layerStart;
+		StateIndex nodeIndex;
+
+		std::vector<std::size_t> depthHistogram;
+		// Bitstate BFS, expected number of states missed
+		double bitstateOmissions;
+
+		// External BFS, contents of the progress file
+		struct ExternalBfsProgress {
+			std::uint64_t fingerprint;
+			Map::PackedState root;
+			bool done;
+			std::uint64_t transitions;
+			std::vector<std::size_t> histogram;
+		};
+
+		static constexpr std::uint32_t EXTERNAL_BFS_MAGIC = 0x42585252u; // "RRXB"
+
+		static void writeExternalBfsProgress(std::string const& fileName, ExternalBfsProgress const& progress) {
+			BinaryWriter out(fileName);
+			out.put(EXTERNAL_BFS_MAGIC);
+			out.put(progress.fingerprint);
+			out.put(progress.root);
+			out.put(progress.done);
+			out.put(progress.transitions);
+			out.putVector(progress.histogram);
+			out.commit();
+		}
+
+		static ExternalBfsProgress readExternalBfsProgress(std::string const& fileName) {
+			BinaryReader in(fileName);
+			if (in.get<std::uint32_t>() != EXTERNAL_BFS_MAGIC) {
+				throw std::runtime_error("bfsExternal: Invalid progress file");
+			}
+			ExternalBfsProgress progress;
+			progress.fingerprint = in.get<std::uint64_t>();
+			progress.root = in.get<Map::PackedState>();
+			progress.done = in.get<bool>();
+			progress.transitions = in.get<std::uint64_t>();
+			progress.histogram = in.getVector<std::size_t>();
+			if (progress.histogram.empty()) {
+				throw std::runtime_error("bfsExternal: Invalid progress file");
+			}
+			return progress;
+		}
+
+		// Checkpoints of bfs() and dfs()
+		static constexpr std::uint32_t BFS_CHECKPOINT_MAGIC = 0x42435252u; // "RRCB"
+		static constexpr std::uint32_t DFS_CHECKPOINT_MAGIC = 0x44435252u; // "RRCD"
+
+		/**
+		 * Decides when the next checkpoint is due, looking at the clock
+		 * only every few thousand calls
+		 */
+		class CheckpointTimer {
+		public:
+			explicit CheckpointTimer(CheckpointOptions const& options) : m_enabled(!options.file.empty()), m_interval(options.intervalSeconds), m_calls(0u), m_last(std::chrono::steady_clock::now()) {}
+
+			bool due() {
+				if (!m_enabled || (++m_calls & 0xFFFu) != 0u) {
+					return false;
+				}
+				auto const now = std::chrono::steady_clock::now();
+				if (std::chrono::duration<double>(now - m_last).count() < m_interval) {
+					return false;
+				}
+				m_last = now;
+				return true;
+			}
+		private:
+			bool const m_enabled;
+			double const m_interval;
+			std::size_t m_calls;
+			std::chrono::steady_clock::time_point m_last;
+		};
+
+		static bool resumeCheckpoint(CheckpointOptions const& options) {
+			return !options.file.empty() && options.resume && std::filesystem::exists(options.file);
+		}
+
+		static void removeCheckpoint(CheckpointOptions const& options) {
+			if (!options.file.empty()) {
+				std::filesystem::remove(options.file);
+			}
+		}
+
+		static void checkCheckpointHeader(BinaryReader& in, std::uint32_t magic, ricochet::Map const& map) {
+			if (in.get<std::uint32_t>() != magic) {
+				throw std::runtime_error("Checkpoint: Invalid file");
+			}
+			if (in.get<std::uint64_t>() != map.fingerprint() || in.get<Map::PackedState>() != map.pack(map.state())) {
+				throw std::runtime_error("Checkpoint: File belongs to a different map or start state");
+			}
+		}
+
+		void saveBfsCheckpoint(ricochet::Map const& map, std::string const& fileName, std::size_t index, std::size_t layerEnd) const {
+			BinaryWriter out(fileName);
+			out.put(BFS_CHECKPOINT_MAGIC);
+			out.put(map.fingerprint());
+			out.put(nodes.front());
+			out.put(numTrans);
+			out.put(index);
+			out.put(layerEnd);
+			out.putVector(nodes);
+			out.putVector(parents);
+			out.putVector(nodeMoves);
+			out.putVector(layerStart);
+			out.commit();
+		}
+
+		void loadBfsCheckpoint(ricochet::Map const& map, std::string const& fileName, std::size_t& index, std::size_t& layerEnd) {
+			BinaryReader in(fileName);
+			checkCheckpointHeader(in, BFS_CHECKPOINT_MAGIC, map);
+			numTrans = in.get<std::size_t>();
+			index = in.get<std::size_t>();
+			layerEnd = in.get<std::size_t>();
+			nodes = in.getVector<Map::PackedState>();
+			parents = in.getVector<StateIndex::index_t>();
+			nodeMoves = in.getVector<std::uint8_t>();
+			layerStart = in.getVector<std::size_t>();
+			if (parents.size() != nodes.size() || nodeMoves.size() != nodes.size() || index > nodes.size() || layerStart.empty()) {
+				throw std::runtime_error("Checkpoint: Inconsistent BFS data");
+			}
+			// The index only holds node numbers, rebuild it instead of storing it
+			for (std::size_t i = 0u; i < nodes.size(); i++) {
+				nodeIndex.insert(i);
+			}
+		}
+
+		void saveDfsCheckpoint(ricochet::Map const& map, std::string const& fileName, SearchStatus status) const {
+			std::vector<Map::PackedState> keys;
+			std::vector<std::size_t> depths;
+			keys.reserve(states.size());
+			depths.reserve(states.size());
+			for (auto const& entry: states) {
+				keys.push_back(map.pack(entry.first));
+				depths.push_back(entry.second);
+			}
+			std::vector<Map::PackedState> frames;
+			std::vector<std::uint8_t> nextMoves;
+			for (auto const& frame: stack) {
+				frames.push_back(map.pack(frame.state));
+				nextMoves.push_back(frame.nextMove);
+			}
+
+			BinaryWriter out(fileName);
+			out.put(DFS_CHECKPOINT_MAGIC);
+			out.put(map.fingerprint());
+			out.put(frames.front());
+			out.put(numTrans);
+			out.put(maxDepth);
+			out.put(status);
+			out.putVector(keys);
+			out.putVector(depths);
+			out.putVector(frames);
+			out.putVector(nextMoves);
+			out.commit();
+		}
+
+		SearchStatus loadDfsCheckpoint(ricochet::Map const& map, std::string const& fileName) {
+			BinaryReader in(fileName);
+			checkCheckpointHeader(in, DFS_CHECKPOINT_MAGIC, map);
+			numTrans = in.get<std::size_t>();
+			maxDepth = in.get<std::size_t>();
+			SearchStatus const status = in.get<SearchStatus>();
+			std::vector<Map::PackedState> const keys = in.getVector<Map::PackedState>();
+			std::vector<std::size_t> const depths = in.getVector<std::size_t>();
+			std::vector<Map::PackedState> const frames = in.getVector<Map::PackedState>();
+			std::vector<std::uint8_t> const nextMoves = in.getVector<std::uint8_t>();
+			if (keys.size() != depths.size() || frames.size() != nextMoves.size()) {
+				throw std::runtime_error("Checkpoint: Inconsistent DFS data");
+			}
+			states.reserve(keys.size());
+			for (std::size_t i = 0u; i < keys.size(); i++) {
+				states.insert(std::make_pair(map.unpack(keys[i]), depths[i]));
+			}
+			for (std::size_t i = 0u; i < frames.size(); i++) {
+				stack.push_back({ map.unpack(frames[i]), nextMoves[i] });
+			}
+			return status;
+		}
 
-		// BFS
-		std::vector<MoveWithHistory> moves;
-		std::queue<std::size_t> queue;
-		std::unordered_set<Map::State> knownMaps;
+		/**
+		 * Generate all successors of a range of packed states, including
+		 * duplicates, and count the transitions
+		 * @param map Map the states belong to
+		 * @param begin Start of the states to expand
+		 * @param end End of the states to expand
+		 * @param threads Number of threads, each working on a copy of map
+		 * @return Packed successor states in unspecified order
+		 */
+		template<typename Iter>
+		std::vector<Map::PackedState> expandLayer(ricochet::Map const& map, Iter begin, Iter end, unsigned threads) {
+			std::size_t const total = static_cast<std::size_t>(std::distance(begin, end));
+			threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(total / 1024u + 1u)));
+
+			std::vector<std::vector<Map::PackedState>> results(threads);
+			std::vector<std::size_t> transitions(threads, 0u);
+			auto worker = [&](unsigned t) {
+				Map local = map;
+				auto it = begin;
+				std::advance(it, total * t / threads);
+				auto const last = std::next(begin, total * (t + 1u) / threads);
+				auto& out = results[t];
+				out.reserve(static_cast<std::size_t>(std::distance(it, last)) * 4u);
+				for (; it != last; ++it) {
+					Map::State const state = local.unpack(*it);
+					for (ricochet::Color c : ricochet::RobotColors) {
+						for (ricochet::Direction dir : ricochet::AllDirections) {
+							local.loadState(state);
+							if (local.moveRobot(c, dir)) {
+								out.push_back(local.pack(local.state()));
+							}
+						}
+					}
+				}
+				transitions[t] = out.size();
+			};
+
+			std::vector<std::thread> pool;
+			for (unsigned t = 1u; t < threads; t++) {
+				pool.emplace_back(worker, t);
+			}
+			worker(0u);
+			for (auto& thread: pool) {
+				thread.join();
+			}
+
+			numTrans += std::accumulate(transitions.cbegin(), transitions.cend(), static_cast<std::size_t>(0u));
+			for (unsigned t = 1u; t < threads; t++) {
+				results[0].insert(results[0].end(), results[t].cbegin(), results[t].cend());
+				results[t] = std::vector<Map::PackedState>();
+			}
+			return std::move(results[0]);
+		}
 	};
 
 }
\ No newline at end of file
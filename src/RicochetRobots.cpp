@@ -12,6 +12,7 @@
 #include <string>
 #include "MapBuilder.h"
 #include "Game.h"
+#include "PortfolioSolver.h"
 #include "ReachabilityAnalysis.h"
 
 #if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
@@ -113,6 +114,22 @@ int program(std::vector<std::string>& args) {
 	ra.bfs(game.getMap());
 	L3PP_LOG_INFO(l3pp::getRootLogger(), "Done with " << ra.getNumberOfExploredStates() << " visited states and a maximum depth of " << ra.getMaxEncounteredDepth() << ".");
 
+	if (!game.done()) {
+		game.nextGoal();
+		L3PP_LOG_INFO(l3pp::getRootLogger(), "Solving the next goal...");
+		ricochet::PortfolioSolver portfolio(game);
+		auto const result = portfolio.solve();
+		auto const ms = std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count();
+		if (result.strategy.empty()) {
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "No strategy finished after " << ms << " ms.");
+		} else if (result.solution) {
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "Found a solution with " << result.solution->size() << " moves, won by " << result.strategy << " after " << ms << " ms.");
+		} else {
+			L3PP_LOG_INFO(l3pp::getRootLogger(), "No solution exists, proven by " << result.strategy << " after " << ms << " ms.");
+		}
+		game.cancelGoal();
+	}
+
 	auto& map = game.getMap();
 	map.insertRobot({ricochet::Color::BLUE}, ricochet::Pos{1, 0});
 	L3PP_LOG_INFO(l3pp::getRootLogger(), map.state().hash);
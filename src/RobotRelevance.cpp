@@ -0,0 +1,112 @@
+#include "RobotRelevance.h"
+#include "GoalTest.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace ricochet {
+
+	RobotRelevance::RobotRelevance(Map const& map, Goal const& goal, std::vector<Color> const& robots) : m_start{} {
+		GoalTest const goalTest(goal);
+		for (auto c: RobotColors) {
+			if (!map.posValid(map.getRobotPos(c))) {
+				continue;
+			}
+			if (robots.empty() || std::find(robots.cbegin(), robots.cend(), c) != robots.cend()) {
+				m_robots.push_back(c);
+				if (goalTest.isGoalRobot(c)) {
+					m_goalRobots.push_back(c);
+				}
+			}
+		}
+
+		// With several goal robots, any of them may only help another one finish
+		std::optional<GoalDistances> goalDistances;
+		if (m_goalRobots.size() == 1u) {
+			goalDistances.emplace(map, goal, m_goalRobots);
+		}
+		for (auto c: m_robots) {
+			bool const finishes = goalDistances && c == m_goalRobots.front();
+			build(map, c, finishes ? &*goalDistances : nullptr);
+		}
+	}
+
+	void RobotRelevance::build(Map const& map, Color c, GoalDistances const* goalDistances) {
+		Bounds& bounds = m_bounds[toInt(c) - 1u];
+		std::size_t const cells = static_cast<std::size_t>(map.getWidth()) * map.getHeight();
+		bounds.stand.assign(cells, UNREACHABLE);
+		bounds.blocked.assign(cells, UNREACHABLE);
+		bounds.passed.assign(cells, UNREACHABLE);
+
+		// Moves still needed after stopping on a cell
+		auto rest = [&](Pos const& pos) {
+			if (map.getTileType(pos) == TileType::BARRIER) {
+				return UNREACHABLE;
+			}
+			return goalDistances ? goalDistances->distance(c, pos) : 0u;
+		};
+		auto lower = [](std::uint8_t& bound, unsigned moves) {
+			bound = static_cast<std::uint8_t>(std::min<unsigned>(bound, std::min(moves, UNREACHABLE)));
+		};
+
+		m_start[toInt(c) - 1u] = map.getCellIndex(map.getRobotPos(c));
+		std::vector<std::size_t> queue{ m_start[toInt(c) - 1u] };
+		bounds.stand[queue.front()] = 0u;
+		std::vector<Pos> path;
+		for (std::size_t head = 0u; head < queue.size(); head++) {
+			std::size_t const cell = queue[head];
+			unsigned const next = bounds.stand[cell] + 1u;
+			for (auto requested: AllDirections) {
+				Direction dir = requested;
+				map.tracePath(c, map.getCellPos(cell), dir, path);
+
+				// Fewest moves to the goal from the cells the move may stop on, from the end
+				unsigned after = UNREACHABLE;
+				for (std::size_t i = path.size(); i-- > 0u;) {
+					std::size_t const to = map.getCellIndex(path[i]);
+					after = std::min(after, rest(path[i]));
+					lower(bounds.passed[to], next + after);
+					if (i != 0u) {
+						lower(bounds.blocked[to], next + rest(path[i - 1u]));
+					}
+					// Another robot on the next cell may stop the move anywhere but on a barrier
+					if (bounds.stand[to] == UNREACHABLE && map.getTileType(path[i]) != TileType::BARRIER && next < UNREACHABLE) {
+						bounds.stand[to] = static_cast<std::uint8_t>(next);
+						queue.push_back(to);
+					}
+				}
+			}
+		}
+	}
+
+	bool RobotRelevance::affects(Color c, Color other, unsigned depth) const {
+		Bounds const& bounds = m_bounds[toInt(c) - 1u];
+		Bounds const& otherBounds = m_bounds[toInt(other) - 1u];
+		// Leaving the start cell
+		std::size_t const start = m_start[toInt(c) - 1u];
+		if (1u + otherBounds.passed[start] <= depth) {
+			return true;
+		}
+		// Standing in the way
+		for (std::size_t cell = 0u; cell < bounds.stand.size(); cell++) {
+			if (cell != start && bounds.stand[cell] + otherBounds.blocked[cell] <= depth) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::vector<Color> RobotRelevance::relevantRobots(unsigned depth) const {
+		std::vector<Color> relevant = m_goalRobots;
+		for (std::size_t i = 0u; i < relevant.size(); i++) {
+			for (auto c: m_robots) {
+				if (std::find(relevant.cbegin(), relevant.cend(), c) == relevant.cend() && affects(c, relevant[i], depth)) {
+					relevant.push_back(c);
+				}
+			}
+		}
+		std::sort(relevant.begin(), relevant.end());
+		return relevant;
+	}
+
+}
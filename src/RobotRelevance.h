@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Color.h"
+#include "Goal.h"
+#include "GoalDistances.h"
+#include "Map.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Finds the robots whose moves can matter for a goal within a number
+	 * of moves. Leaving another robot where it is only changes a move of
+	 * a robot that matters if that move passes the cell the other robot
+	 * would have moved to and been stopped there, or passes the start
+	 * cell the other robot would have left. The moves needed for either
+	 * are bounded from below on the board without robots, allowing each
+	 * robot to stop on any cell it passes: until the other robot can be
+	 * on the cell, and until the robot that matters can pass it. A single
+	 * goal robot must also reach the goal from where it stops. If the
+	 * bounds add up to more than the depth, the other robot can stay.
+	 * Robots far from the paths of the goal robots are dropped from move
+	 * generation this way.
+	 */
+	class RobotRelevance {
+	public:
+		/// Moves to cells a robot never gets to
+		static constexpr unsigned UNREACHABLE = UINT8_MAX;
+
+		/**
+		 * @param map Board with all robots at their start positions
+		 * @param goal Goal to reach
+		 * @param robots Robots that may move, all robots on the board if empty
+		 */
+		RobotRelevance(Map const& map, Goal const& goal, std::vector<Color> const& robots = {});
+
+		/**
+		 * @param depth Longest solution considered
+		 * @return Robots that may need to move, in color order. Any solution of at most depth moves still reaches the goal without the moves of the others.
+		 */
+		std::vector<Color> relevantRobots(unsigned depth) const;
+	private:
+		struct Bounds {
+			// Moves until the robot may stand on the cell
+			std::vector<std::uint8_t> stand;
+			// Moves of the robot up to one that another robot on the cell
+			// stops, for a single goal robot also those to the goal after it
+			std::vector<std::uint8_t> blocked;
+			// The same for a move passing the cell, once another robot left it
+			std::vector<std::uint8_t> passed;
+		};
+
+		std::vector<Color> m_robots;
+		std::vector<Color> m_goalRobots;
+		// Cell of each robot at the start
+		std::array<std::size_t, RICOCHET_ROBOTS_MAX_ROBOT_COUNT> m_start;
+		std::array<Bounds, RICOCHET_ROBOTS_MAX_ROBOT_COUNT> m_bounds;
+
+		void build(Map const& map, Color c, GoalDistances const* goalDistances);
+		bool affects(Color c, Color other, unsigned depth) const;
+	};
+
+}
@@ -0,0 +1,205 @@
+#include "AStarSearch.h"
+#include "GoalTest.h"
+#include "Map.h"
+#include "MapBuilder.h"
+#include "OptimalSolutions.h"
+#include "RobotRelevance.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+ * Checks the optimal solvers against an exhaustive breadth first search
+ * on random small boards: AStarSearch with and without pruneRobots must
+ * find solutions of the optimal length, and OptimalSolutions must count
+ * every shortest move sequence.
+ */
+
+using namespace ricochet;
+
+namespace {
+	struct Reference {
+		// 0 if there is no solution within the depth limit
+		unsigned length;
+		std::uint64_t count;
+	};
+
+	// Count the shortest move sequences layer by layer. A shortest sequence
+	// reaches each of its states at the depth they are first seen at,
+	// otherwise a shorter one would exist.
+	Reference exhaustiveSearch(Map map, Goal const& goal, unsigned depthLimit) {
+		GoalTest const goalTest(goal);
+		unsigned const flagShift = RICOCHET_ROBOTS_MAX_ROBOT_COUNT * map.getPackedBitsPerRobot();
+		std::vector<Color> robots;
+		for (auto c: RobotColors) {
+			if (map.posValid(map.state().robots[toInt(c)])) {
+				robots.push_back(c);
+			}
+		}
+
+		struct Node {
+			Map::State state;
+			GoalTest::flags_t flags;
+			std::uint64_t paths;
+		};
+		std::vector<Node> layer{ { map.state(), 0u, 1u } };
+		std::unordered_set<std::uint64_t> seen{ map.pack(map.state()) };
+		for (unsigned depth = 1u; depth <= depthLimit && !layer.empty(); depth++) {
+			std::uint64_t solutions = 0u;
+			std::vector<Node> next;
+			std::unordered_map<std::uint64_t, std::size_t> nextIndex;
+			for (Node const& node: layer) {
+				for (auto c: robots) {
+					for (auto requested: AllDirections) {
+						map.loadState(node.state);
+						Direction dir = requested;
+						if (!map.moveRobot(c, dir)) {
+							continue;
+						}
+						if (goalTest.finishes(map, c, requested, node.flags)) {
+							solutions += node.paths;
+							continue;
+						}
+						GoalTest::flags_t const flags = goalTest.update(node.flags, c, dir);
+						std::uint64_t const key = map.pack(map.state()) | (static_cast<std::uint64_t>(flags) << flagShift);
+						if (seen.count(key) != 0u && nextIndex.count(key) == 0u) {
+							continue;
+						}
+						auto const inserted = nextIndex.emplace(key, next.size());
+						if (inserted.second) {
+							seen.insert(key);
+							next.push_back({ map.state(), flags, 0u });
+						}
+						next[inserted.first->second].paths += node.paths;
+					}
+				}
+			}
+			if (solutions != 0u) {
+				return { depth, solutions };
+			}
+			layer.swap(next);
+		}
+		return { 0u, 0u };
+	}
+
+	bool isSolution(Map map, Goal const& goal, MoveSequence const& moves) {
+		GoalTest const goalTest(goal);
+		GoalTest::flags_t flags = 0u;
+		for (std::size_t i = 0u; i < moves.size(); i++) {
+			Direction dir = moves[i].dir;
+			if (!map.moveRobot(moves[i].color, dir)) {
+				return false;
+			}
+			if (goalTest.finishes(map, moves[i].color, moves[i].dir, flags) != (i + 1u == moves.size())) {
+				return false;
+			}
+			flags = goalTest.update(flags, moves[i].color, dir);
+		}
+		return !moves.empty();
+	}
+
+	Map randomBoard(std::mt19937& random, std::size_t size, std::size_t robotCount) {
+		auto const randomPos = [&random, size]() {
+			return Position(static_cast<coord>(random() % size), static_cast<coord>(random() % size));
+		};
+		// Barriers and goals need a cell of their own
+		std::vector<Position> taken;
+		auto const freePos = [&randomPos, &taken]() {
+			Position pos;
+			do {
+				pos = randomPos();
+			} while (std::find(taken.cbegin(), taken.cend(), pos) != taken.cend());
+			taken.push_back(pos);
+			return pos;
+		};
+		MapBuilder builder(size, size);
+		for (std::size_t i = 0u; i < size * 2u; i++) {
+			builder.addWall(AllDirections[random() % AllDirections.size()], randomPos());
+		}
+		for (std::size_t i = 0u; i < 2u; i++) {
+			builder.addBarrier(RobotColors[random() % robotCount], random() % 2u == 0u ? BarrierType::FWD : BarrierType::BWD, freePos());
+		}
+		for (std::size_t i = 0u; i < 4u; i++) {
+			Color const color = (i == 3u) ? Color::MIX : RobotColors[random() % robotCount];
+			builder.addGoal(color, GoalType::RECTANGLE_SATURN, freePos());
+		}
+		Map map = builder.toMap();
+
+		std::vector<std::size_t> used;
+		for (std::size_t i = 0u; i < robotCount; i++) {
+			std::size_t cell;
+			TileType tile;
+			do {
+				cell = random() % (size * size);
+				tile = map.getTileType(map.getCellPos(cell));
+			} while (std::find(used.cbegin(), used.cend(), cell) != used.cend() || (tile != TileType::EMPTY && tile != TileType::GOAL));
+			used.push_back(cell);
+			map.insertRobot(Robot{ RobotColors[i] }, map.getCellPos(cell));
+		}
+		return map;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	unsigned const boards = (argc > 1) ? static_cast<unsigned>(std::stoul(argv[1])) : 40u;
+	std::mt19937 random(2024u);
+	unsigned goals = 0u;
+	unsigned solved = 0u;
+	unsigned pruned = 0u;
+	unsigned failures = 0u;
+	auto const fail = [&failures](unsigned board, std::string const& what) {
+		std::cout << "Board " << board << ": " << what << std::endl;
+		failures++;
+	};
+
+	for (unsigned board = 0u; board < boards; board++) {
+		std::size_t const robotCount = 2u + board % 3u;
+		Map const map = randomBoard(random, 6u + board % 3u, robotCount);
+		for (auto const& goal: map.getGoals()) {
+			// Short limits leave robots out more often
+			unsigned const depthLimit = 2u + static_cast<unsigned>(random() % 7u);
+			goals++;
+			Reference const reference = exhaustiveSearch(map, goal, depthLimit);
+			if (reference.length != 0u) {
+				solved++;
+			}
+			if (RobotRelevance(map, goal).relevantRobots(depthLimit).size() < robotCount) {
+				pruned++;
+			}
+
+			for (bool pruneRobots: { false, true }) {
+				AStarOptions options;
+				options.depthLimit = depthLimit;
+				options.pruneRobots = pruneRobots;
+				AStarSearch search(map, goal, options);
+				std::optional<MoveSequence> const solution = search.solve();
+				unsigned const length = solution ? static_cast<unsigned>(solution->size()) : 0u;
+				if (length != reference.length) {
+					fail(board, std::string("AStarSearch") + (pruneRobots ? " with" : " without") + " pruning found " + std::to_string(length) + " moves instead of " + std::to_string(reference.length));
+				} else if (solution && !isSolution(map, goal, *solution)) {
+					fail(board, std::string("AStarSearch") + (pruneRobots ? " with" : " without") + " pruning returned an invalid solution");
+				}
+			}
+
+			OptimalSolutionsOptions options;
+			options.depthLimit = depthLimit;
+			OptimalSolutions solutions(map, goal, options);
+			bool const found = solutions.search();
+			if (found != (reference.length != 0u) || solutions.getLength() != reference.length) {
+				fail(board, "OptimalSolutions found " + std::to_string(solutions.getLength()) + " moves instead of " + std::to_string(reference.length));
+			} else if (solutions.getCount() != reference.count) {
+				fail(board, "OptimalSolutions counted " + std::to_string(solutions.getCount()) + " solutions instead of " + std::to_string(reference.count));
+			}
+		}
+	}
+
+	std::cout << goals << " goals on " << boards << " boards, " << solved << " solvable, " << pruned << " with robots pruned, " << failures << " failures" << std::endl;
+	return (failures == 0u) ? 0 : 1;
+}
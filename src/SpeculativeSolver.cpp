@@ -0,0 +1,215 @@
+#include "SpeculativeSolver.h"
+#include "AStarSearch.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ricochet {
+
+	namespace {
+		IncrementalOptions incrementalOptions(SpeculativeOptions const& options, std::atomic<bool> const& preempt, std::atomic<bool> const& stop) {
+			IncrementalOptions result;
+			result.depthLimit = options.depthLimit;
+			result.maxStates = options.maxStates;
+			result.interrupt = [&preempt, &stop]() {
+				return preempt || stop;
+			};
+			return result;
+		}
+
+		// Only run the worker when nothing else wants the processor
+		void lowerPriority() {
+#if defined(WIN32) || defined(WIN64) || defined(_MSC_VER)
+			SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(SCHED_IDLE)
+			sched_param param{};
+			pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+		}
+	}
+
+	SpeculativeSolver::SpeculativeSolver(Game const& game, SpeculativeOptions const& options) :
+			m_map(game.getMap()), m_options(options), m_preempt(false), m_stop(false),
+			m_solver(game.getMap(), incrementalOptions(options, m_preempt, m_stop))
+	{
+		plan(game);
+		m_worker = std::thread(&SpeculativeSolver::run, this);
+	}
+
+	SpeculativeSolver::~SpeculativeSolver() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		m_worker.join();
+	}
+
+	SpeculativeSolver::key_t SpeculativeSolver::key(Map::State const& state, Goal const& goal) const {
+		std::uint32_t const goalKey = static_cast<std::uint32_t>(m_map.getCellIndex(goal.pos) << 8u) | static_cast<std::uint32_t>(toInt(goal.color) << 4u) | toInt(goal.type);
+		return { m_map.pack(state), goalKey };
+	}
+
+	void SpeculativeSolver::update(Game const& game) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			plan(game);
+		}
+		m_wake.notify_all();
+	}
+
+	std::vector<SpeculativeSolver::Task> SpeculativeSolver::followUps(Task const& task, std::optional<MoveSequence> const& solution) const {
+		std::vector<Task> result;
+		if (!solution) {
+			return result;
+		}
+		Map board = m_map;
+		board.loadState(task.state);
+		for (auto const& move: *solution) {
+			Direction dir = move.dir;
+			board.moveRobot(move.color, dir);
+		}
+		for (auto const& goal: m_remainingGoals) {
+			result.push_back({ board.state(), goal, false });
+		}
+		return result;
+	}
+
+	void SpeculativeSolver::queueFollowUps(Task const& task, std::optional<MoveSequence> const& solution) {
+		std::vector<Task> const next = followUps(task, solution);
+		for (auto it = next.crbegin(); it != next.crend(); ++it) {
+			if (m_cache.find(key(it->state, it->goal)) == m_cache.cend()) {
+				m_tasks.push_front(*it);
+			}
+		}
+	}
+
+	void SpeculativeSolver::plan(Game const& game) {
+		m_tasks.clear();
+		m_remainingGoals = game.getRemainingGoals();
+		Map::State const state = game.getMap().state();
+
+		std::vector<Task> wanted;
+		if (game.getCurrentGoal()) {
+			wanted.push_back({ state, *game.getCurrentGoal(), true });
+			auto const cached = m_cache.find(key(state, *game.getCurrentGoal()));
+			if (cached != m_cache.cend()) {
+				std::vector<Task> const next = followUps(wanted.front(), cached->second);
+				wanted.insert(wanted.end(), next.cbegin(), next.cend());
+			}
+		}
+		for (auto const& goal: m_remainingGoals) {
+			wanted.push_back({ state, goal, false });
+		}
+
+		bool runningWanted = false;
+		for (auto const& task: wanted) {
+			key_t const k = key(task.state, task.goal);
+			if (m_running && key(m_running->state, m_running->goal) == k) {
+				runningWanted = true;
+				m_running->followUp = m_running->followUp || task.followUp;
+			} else if (m_cache.find(k) == m_cache.cend()) {
+				m_tasks.push_back(task);
+			}
+		}
+		if (m_running && !runningWanted) {
+			m_preempt = true;
+		}
+	}
+
+	bool SpeculativeSolver::lookup(Map::State const& state, Goal const& goal, std::optional<MoveSequence>& solution) const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto const it = m_cache.find(key(state, goal));
+		if (it == m_cache.cend()) {
+			return false;
+		}
+		solution = it->second;
+		return true;
+	}
+
+	std::optional<MoveSequence> SpeculativeSolver::solve(Game const& game) {
+		if (!game.getCurrentGoal()) {
+			throw std::invalid_argument("SpeculativeSolver: Game has no current goal");
+		}
+		Goal const goal = *game.getCurrentGoal();
+		key_t const k = key(game.getMap().state(), goal);
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_solved.wait(lock, [this, &k]() {
+				return m_cache.find(k) != m_cache.cend() || !m_running || key(m_running->state, m_running->goal) != k;
+			});
+			auto const it = m_cache.find(k);
+			if (it != m_cache.cend()) {
+				return it->second;
+			}
+		}
+
+		// Not under way, search on this thread
+		AStarOptions options;
+		options.depthLimit = m_options.depthLimit;
+		options.maxStates = m_options.maxStates;
+		AStarSearch search(game.getMap(), goal, options);
+		auto solution = search.solve();
+		if (!search.limitReached()) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_cache[k] = solution;
+		}
+		return solution;
+	}
+
+	std::size_t SpeculativeSolver::getCachedCount() const {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_cache.size();
+	}
+
+	void SpeculativeSolver::run() {
+		lowerPriority();
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			m_wake.wait(lock, [this]() {
+				return m_stop || !m_tasks.empty();
+			});
+			if (m_stop) {
+				break;
+			}
+			Task const next = m_tasks.front();
+			m_tasks.pop_front();
+			auto const cached = m_cache.find(key(next.state, next.goal));
+			if (cached != m_cache.cend()) {
+				// Solved by solve() on the calling thread since it was queued
+				if (next.followUp) {
+					queueFollowUps(next, cached->second);
+				}
+				continue;
+			}
+			m_running = next;
+			m_preempt = false;
+			Task const task = *m_running;
+			lock.unlock();
+
+			auto solution = m_solver.solve(task.state, task.goal);
+			bool const optimal = m_solver.isOptimal();
+
+			lock.lock();
+			if (optimal) {
+				m_cache[key(task.state, task.goal)] = solution;
+				// followUp may have been set by a replan while searching
+				if (m_running->followUp) {
+					queueFollowUps(task, solution);
+				}
+			}
+			m_running.reset();
+			m_solved.notify_all();
+		}
+	}
+
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Game.h"
+#include "Goal.h"
+#include "IncrementalSolver.h"
+#include "Map.h"
+#include "MoveSequence.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ricochet {
+
+	struct SpeculativeOptions {
+		/// Longest solution searched for, at most 254
+		unsigned depthLimit = 20u;
+		/// States a search may hold before it gives up, 0 for no limit. Goals it gives up on are not cached.
+		std::size_t maxStates = 0u;
+	};
+
+	/**
+	 * Solves goals of a game in the background before they are asked for,
+	 * so that bots and hints find the answer waiting. A worker thread at
+	 * the lowest scheduling priority works through the goals in order of
+	 * how soon they may be needed: the current goal from the current
+	 * state, then every remaining goal from the state its solution leaves
+	 * the robots in, where the next round most likely starts, then every
+	 * remaining goal from the current state, in case the goal is
+	 * cancelled. Optimal results are cached by state and goal, including
+	 * those proving there is no solution within the depth limit.
+	 * update() replans after every change of the game; the search under
+	 * way is only interrupted if it is no longer needed.
+	 */
+	class SpeculativeSolver {
+	public:
+		/**
+		 * Start speculating on a game
+		 * @param game Game on the board all later calls refer to
+		 * @param options Search options
+		 */
+		SpeculativeSolver(Game const& game, SpeculativeOptions const& options = SpeculativeOptions());
+
+		~SpeculativeSolver();
+
+		SpeculativeSolver(SpeculativeSolver const&) = delete;
+		SpeculativeSolver& operator=(SpeculativeSolver const&) = delete;
+
+		/**
+		 * Replan for the goals and robot positions of a game, e.g. after
+		 * Game::nextGoal(), Game::doMove() or Game::cancelGoal()
+		 * @param game Game on the same board
+		 */
+		void update(Game const& game);
+
+		/**
+		 * Look up a cached result without waiting
+		 * @param state Robot positions to start from
+		 * @param goal Goal to reach
+		 * @param solution Set to the cached optimal solution, or empty if there is none within depthLimit
+		 * @return true iff a result was cached
+		 */
+		bool lookup(Map::State const& state, Goal const& goal, std::optional<MoveSequence>& solution) const;
+
+		/**
+		 * Solve the current goal of a game: from the cache, by waiting for
+		 * the worker if it is on it, or on the calling thread otherwise
+		 * @param game Game with a current goal, on the same board
+		 * @return Shortest move sequence reaching the goal, if one is found within the limits
+		 */
+		std::optional<MoveSequence> solve(Game const& game);
+
+		/**
+		 * @return Number of cached results
+		 */
+		std::size_t getCachedCount() const;
+	private:
+		// Packed state and goal
+		typedef std::pair<Map::PackedState, std::uint32_t> key_t;
+
+		struct Task {
+			Map::State state;
+			Goal goal;
+			// Queue the remaining goals from the state the solution leaves
+			bool followUp;
+		};
+
+		Map m_map;
+		SpeculativeOptions m_options;
+		// Interrupt the search of the worker
+		std::atomic<bool> m_preempt;
+		std::atomic<bool> m_stop;
+		// Used by the worker only
+		IncrementalSolver m_solver;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_solved;
+		std::deque<Task> m_tasks;
+		std::optional<Task> m_running;
+		std::vector<Goal> m_remainingGoals;
+		std::map<key_t, std::optional<MoveSequence>> m_cache;
+		std::thread m_worker;
+
+		key_t key(Map::State const& state, Goal const& goal) const;
+		// Tasks for the remaining goals from the state a solution leaves the robots in
+		std::vector<Task> followUps(Task const& task, std::optional<MoveSequence> const& solution) const;
+		// Put them first in the queue, unless cached
+		void queueFollowUps(Task const& task, std::optional<MoveSequence> const& solution);
+		void plan(Game const& game);
+		void run();
+	};
+
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include "Map.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Mix the bits of a packed state, so that neighbouring states spread
+	 * over the whole table (finalizer of splitmix64)
+	 * @param p Packed state
+	 * @return Hash value
+	 */
+	inline std::uint64_t hashPacked(Map::PackedState p) {
+		p ^= p >> 30u;
+		p *= 0xbf58476d1ce4e5b9ull;
+		p ^= p >> 27u;
+		p *= 0x94d049bb133111ebull;
+		p ^= p >> 31u;
+		return p;
+	}
+
+	/**
+	 * Open addressing hash table mapping packed states to their index in
+	 * an external array of packed states. Only the 32 bit indices are
+	 * stored, the keys are looked up in the array, which keeps the table
+	 * at a few bytes per state.
+	 */
+	class StateIndex {
+	public:
+		typedef std::uint32_t index_t;
+
+		explicit StateIndex(std::vector<Map::PackedState> const& keys) : m_keys(&keys), m_size(0u) {
+			//
+		}
+
+		void clear() {
+			m_slots.clear();
+			m_size = 0u;
+		}
+
+		std::size_t size() const {
+			return m_size;
+		}
+
+		/**
+		 * Look up a state
+		 * @param key Packed state
+		 * @return Index of the state in the key array, if present
+		 */
+		std::optional<index_t> find(Map::PackedState key) const {
+			if (m_slots.empty()) {
+				return std::nullopt;
+			}
+			std::size_t const mask = m_slots.size() - 1u;
+			for (std::size_t slot = hashPacked(key) & mask; m_slots[slot] != EMPTY; slot = (slot + 1u) & mask) {
+				if ((*m_keys)[m_slots[slot]] == key) {
+					return m_slots[slot];
+				}
+			}
+			return std::nullopt;
+		}
+
+		/**
+		 * Insert the state stored at the given index of the key array,
+		 * unless an equal state is already present
+		 * @param index Index of the state in the key array
+		 * @return Index of the state in the table and true iff it was inserted
+		 */
+		std::pair<index_t, bool> insert(std::size_t index) {
+			if (index >= EMPTY) {
+				throw std::length_error("StateIndex: Too many states");
+			}
+			if ((m_size + 1u) * 10u > m_slots.size() * 7u) {
+				grow();
+			}
+			Map::PackedState const key = (*m_keys)[index];
+			std::size_t const mask = m_slots.size() - 1u;
+			std::size_t slot = hashPacked(key) & mask;
+			for (; m_slots[slot] != EMPTY; slot = (slot + 1u) & mask) {
+				if ((*m_keys)[m_slots[slot]] == key) {
+					return { m_slots[slot], false };
+				}
+			}
+			m_slots[slot] = static_cast<index_t>(index);
+			m_size++;
+			return { static_cast<index_t>(index), true };
+		}
+
+		/**
+		 * @return Memory held by the table in bytes
+		 */
+		std::size_t getMemoryUsage() const {
+			return m_slots.capacity() * sizeof(index_t);
+		}
+	private:
+		static constexpr index_t EMPTY = std::numeric_limits<index_t>::max();
+
+		std::vector<Map::PackedState> const* m_keys;
+		std::vector<index_t> m_slots;
+		std::size_t m_size;
+
+		void grow() {
+			std::vector<index_t> old(m_slots.empty() ? 1024u : m_slots.size() * 2u, EMPTY);
+			old.swap(m_slots);
+			std::size_t const mask = m_slots.size() - 1u;
+			for (index_t index: old) {
+				if (index != EMPTY) {
+					std::size_t slot = hashPacked((*m_keys)[index]) & mask;
+					while (m_slots[slot] != EMPTY) {
+						slot = (slot + 1u) & mask;
+					}
+					m_slots[slot] = index;
+				}
+			}
+		}
+	};
+
+	/**
+	 * Open addressing hash set of packed states, storing the keys
+	 * directly. Used where states are not kept in an array anyway.
+	 */
+	class PackedStateSet {
+	public:
+		PackedStateSet() : m_size(0u), m_hasEmptyKey(false) {}
+
+		void clear() {
+			m_slots.clear();
+			m_size = 0u;
+			m_hasEmptyKey = false;
+		}
+
+		std::size_t size() const {
+			return m_size;
+		}
+
+		bool empty() const {
+			return m_size == 0u;
+		}
+
+		bool contains(Map::PackedState key) const {
+			if (key == EMPTY) {
+				return m_hasEmptyKey;
+			}
+			if (m_slots.empty()) {
+				return false;
+			}
+			std::size_t const mask = m_slots.size() - 1u;
+			for (std::size_t slot = hashPacked(key) & mask; m_slots[slot] != EMPTY; slot = (slot + 1u) & mask) {
+				if (m_slots[slot] == key) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		 * Insert a state
+		 * @param key Packed state
+		 * @return true iff the state was not present before
+		 */
+		bool insert(Map::PackedState key) {
+			if (key == EMPTY) {
+				if (m_hasEmptyKey) {
+					return false;
+				}
+				m_hasEmptyKey = true;
+				m_size++;
+				return true;
+			}
+			if ((m_size + 1u) * 10u > m_slots.size() * 7u) {
+				grow();
+			}
+			std::size_t const mask = m_slots.size() - 1u;
+			std::size_t slot = hashPacked(key) & mask;
+			for (; m_slots[slot] != EMPTY; slot = (slot + 1u) & mask) {
+				if (m_slots[slot] == key) {
+					return false;
+				}
+			}
+			m_slots[slot] = key;
+			m_size++;
+			return true;
+		}
+
+		/**
+		 * Call a function for each state in the set, in no particular order
+		 * @param f Function taking a packed state
+		 */
+		template<typename F>
+		void forEach(F&& f) const {
+			if (m_hasEmptyKey) {
+				f(EMPTY);
+			}
+			for (Map::PackedState key: m_slots) {
+				if (key != EMPTY) {
+					f(key);
+				}
+			}
+		}
+
+		/**
+		 * @return Memory held by the set in bytes
+		 */
+		std::size_t getMemoryUsage() const {
+			return m_slots.capacity() * sizeof(Map::PackedState);
+		}
+	private:
+		// All robots off the map, stored outside of the table
+		static constexpr Map::PackedState EMPTY = std::numeric_limits<Map::PackedState>::max();
+
+		std::vector<Map::PackedState> m_slots;
+		std::size_t m_size;
+		bool m_hasEmptyKey;
+
+		void grow() {
+			std::vector<Map::PackedState> old(m_slots.empty() ? 1024u : m_slots.size() * 2u, EMPTY);
+			old.swap(m_slots);
+			std::size_t const mask = m_slots.size() - 1u;
+			for (Map::PackedState key: old) {
+				if (key != EMPTY) {
+					std::size_t slot = hashPacked(key) & mask;
+					while (m_slots[slot] != EMPTY) {
+						slot = (slot + 1u) & mask;
+					}
+					m_slots[slot] = key;
+				}
+			}
+		}
+	};
+
+}
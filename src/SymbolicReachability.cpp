@@ -0,0 +1,183 @@
+#include "SymbolicReachability.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ricochet {
+
+	namespace {
+		std::vector<Color> robotsOnBoard(Map const& map) {
+			std::vector<Color> result;
+			for (auto c: RobotColors) {
+				if (map.posValid(map.getRobotPos(c))) {
+					result.push_back(c);
+				}
+			}
+			return result;
+		}
+
+		unsigned bitsPerCell(Map const& map) {
+			std::size_t const cells = static_cast<std::size_t>(map.getWidth()) * map.getHeight();
+			unsigned bits = 1u;
+			while ((static_cast<std::size_t>(1u) << bits) < cells) {
+				bits++;
+			}
+			return bits;
+		}
+
+		unsigned variableCount(Map const& map) {
+			std::size_t const variables = robotsOnBoard(map).size() * bitsPerCell(map);
+			if (variables >= 64u) {
+				throw std::invalid_argument("SymbolicReachability: Board too large");
+			}
+			return static_cast<unsigned>(variables);
+		}
+	}
+
+	SymbolicReachability::SymbolicReachability(Map const& map) :
+			m_map(map), m_robots(robotsOnBoard(map)), m_bits(bitsPerCell(map)), m_bdd(variableCount(map)),
+			m_reached(BddManager::ZERO), m_frontier(BddManager::ZERO), m_frontierNodes(0u), m_collectAt(0u)
+	{
+		std::size_t const cells = cellCount();
+		for (std::size_t cell = 0u; cell < cells; cell++) {
+			TileType const tile = m_map.getTileType(m_map.getCellPos(cell));
+			if (tile == TileType::EMPTY || tile == TileType::GOAL) {
+				m_cells.push_back(static_cast<std::uint32_t>(cell));
+			}
+		}
+
+		m_at.assign(m_robots.size() * cells, BddManager::ZERO);
+		for (std::size_t r = 0u; r < m_robots.size(); r++) {
+			for (std::uint32_t const cell: m_cells) {
+				m_at[r * cells + cell] = m_bdd.cube(static_cast<unsigned>(r * m_bits), m_bits, cell);
+			}
+		}
+		m_occupied.assign(m_robots.size() * cells, BddManager::ZERO);
+		for (std::size_t r = 0u; r < m_robots.size(); r++) {
+			for (std::uint32_t const cell: m_cells) {
+				for (std::size_t other = 0u; other < m_robots.size(); other++) {
+					if (other != r) {
+						m_occupied[r * cells + cell] = m_bdd.disjunction(m_occupied[r * cells + cell], m_at[other * cells + cell]);
+					}
+				}
+			}
+		}
+
+		// Where each move goes on the board without robots
+		std::vector<Pos> trace;
+		m_paths.assign(m_robots.size() * cells * AllDirections.size(), { 0u, 0u, false });
+		for (std::size_t r = 0u; r < m_robots.size(); r++) {
+			for (std::uint32_t const cell: m_cells) {
+				for (std::size_t d = 0u; d < AllDirections.size(); d++) {
+					Direction dir = AllDirections[d];
+					Path& path = m_paths[(r * cells + cell) * AllDirections.size() + d];
+					path.stops = m_map.tracePath(m_robots[r], m_map.getCellPos(cell), dir, trace);
+					path.first = static_cast<std::uint32_t>(m_pathSteps.size());
+					path.length = static_cast<std::uint32_t>(trace.size());
+					for (std::size_t i = 0u; i < trace.size(); i++) {
+						bool const stopBefore = i != 0u && m_map.getTileType(trace[i - 1u]) != TileType::BARRIER;
+						m_pathSteps.push_back({ static_cast<std::uint32_t>(m_map.getCellIndex(trace[i])), stopBefore });
+					}
+				}
+			}
+		}
+
+		BddManager::node_t start = BddManager::ONE;
+		for (std::size_t r = 0u; r < m_robots.size(); r++) {
+			start = m_bdd.conjunction(start, m_at[r * cells + map.getCellIndex(map.getRobotPos(m_robots[r]))]);
+		}
+		m_reached = start;
+		m_frontier = start;
+		m_frontierNodes = m_bdd.nodeCount(start);
+		m_depthHistogram.push_back(1u);
+		collectGarbage();
+	}
+
+	bool SymbolicReachability::step() {
+		if (m_frontier == BddManager::ZERO) {
+			return false;
+		}
+		// Garbage may be collected while the image is built, renumbering the members
+		BddManager::node_t const successors = image(m_frontier);
+		BddManager::node_t const next = m_bdd.difference(successors, m_reached);
+		m_reached = m_bdd.disjunction(m_reached, next);
+		m_frontier = next;
+		m_frontierNodes = m_bdd.nodeCount(next);
+		if (next != BddManager::ZERO) {
+			m_depthHistogram.push_back(static_cast<std::size_t>(m_bdd.satCount(next)));
+		}
+		if (m_bdd.getNodeCount() > m_collectAt) {
+			collectGarbage();
+		}
+		return next != BddManager::ZERO;
+	}
+
+	BddManager::node_t SymbolicReachability::image(BddManager::node_t states) {
+		std::size_t const cells = cellCount();
+		BddManager::node_t result = BddManager::ZERO;
+		// Other robots of the states that end on each cell
+		std::vector<BddManager::node_t> arrivals(cells);
+		for (std::size_t r = 0u; r < m_robots.size(); r++) {
+			std::fill(arrivals.begin(), arrivals.end(), BddManager::ZERO);
+			for (std::uint32_t const cell: m_cells) {
+				BddManager::node_t const here = m_bdd.cofactor(states, m_at[r * cells + cell]);
+				if (here == BddManager::ZERO) {
+					continue;
+				}
+				for (std::size_t d = 0u; d < AllDirections.size(); d++) {
+					Path const& path = m_paths[(r * cells + cell) * AllDirections.size() + d];
+					BddManager::node_t free = here;
+					for (std::uint32_t i = 0u; i < path.length && free != BddManager::ZERO; i++) {
+						PathStep const& step = m_pathSteps[path.first + i];
+						BddManager::node_t const occupied = m_occupied[r * cells + step.cell];
+						if (step.stopBefore) {
+							std::uint32_t const stop = m_pathSteps[path.first + i - 1u].cell;
+							arrivals[stop] = m_bdd.disjunction(arrivals[stop], m_bdd.conjunction(free, occupied));
+						}
+						free = m_bdd.difference(free, occupied);
+					}
+					if (path.stops && free != BddManager::ZERO) {
+						std::uint32_t const stop = m_pathSteps[path.first + path.length - 1u].cell;
+						arrivals[stop] = m_bdd.disjunction(arrivals[stop], free);
+					}
+				}
+			}
+			for (std::uint32_t const cell: m_cells) {
+				if (arrivals[cell] != BddManager::ZERO) {
+					result = m_bdd.disjunction(result, m_bdd.conjunction(arrivals[cell], m_at[r * cells + cell]));
+				}
+			}
+			if (m_bdd.getNodeCount() > m_collectAt) {
+				collectGarbage({ &states, &result });
+			}
+		}
+		return result;
+	}
+
+	void SymbolicReachability::collectGarbage(std::vector<BddManager::node_t*> const& temporaries) {
+		std::vector<BddManager::node_t> roots;
+		roots.reserve(m_at.size() + m_occupied.size() + 2u + temporaries.size());
+		roots.insert(roots.end(), m_at.cbegin(), m_at.cend());
+		roots.insert(roots.end(), m_occupied.cbegin(), m_occupied.cend());
+		roots.push_back(m_reached);
+		roots.push_back(m_frontier);
+		for (BddManager::node_t const* node: temporaries) {
+			roots.push_back(*node);
+		}
+		m_bdd.collectGarbage(roots);
+
+		auto it = roots.cbegin();
+		std::copy_n(it, m_at.size(), m_at.begin());
+		it += static_cast<std::ptrdiff_t>(m_at.size());
+		std::copy_n(it, m_occupied.size(), m_occupied.begin());
+		it += static_cast<std::ptrdiff_t>(m_occupied.size());
+		m_reached = *it++;
+		m_frontier = *it++;
+		for (BddManager::node_t* node: temporaries) {
+			*node = *it++;
+		}
+		// Collect again once the live nodes have doubled, but not for small diagrams
+		m_collectAt = std::max<std::size_t>(2u * m_bdd.getNodeCount(), 1u << 20u);
+	}
+
+}
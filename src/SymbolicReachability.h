@@ -0,0 +1,95 @@
+#pragma once
+
+#include "BddManager.h"
+#include "Map.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ricochet {
+
+	/**
+	 * Breadth first search over sets of states held as binary decision
+	 * diagrams instead of explicit lists. Each robot on the board is
+	 * encoded by the bits of its cell index, robot after robot. The image
+	 * of a set is built per moving robot, start cell and direction: the
+	 * set is restricted to the robot on the start cell, then the cells of
+	 * the move are walked on the board without robots, splitting off the
+	 * states in which another robot occupies the next cell and stops the
+	 * move. Layers of structured state spaces may stay far smaller than
+	 * their number of states.
+	 */
+	class SymbolicReachability {
+	public:
+		/**
+		 * @param map Board with all robots at their start positions, which are depth 0
+		 */
+		explicit SymbolicReachability(Map const& map);
+
+		/**
+		 * Compute the states first reached at the next depth
+		 * @return false if there are none, the search is complete
+		 */
+		bool step();
+
+		/**
+		 * @return States per depth, starting with the initial state at depth 0
+		 */
+		std::vector<std::size_t> const& getDepthHistogram() const {
+			return m_depthHistogram;
+		}
+
+		/**
+		 * @return Nodes of the diagrams of the last layer
+		 */
+		std::size_t getFrontierNodes() const {
+			return m_frontierNodes;
+		}
+
+		/**
+		 * @return Bytes held by the diagram package
+		 */
+		std::size_t getMemoryUsage() const {
+			return m_bdd.getMemoryUsage();
+		}
+	private:
+		struct PathStep {
+			std::uint32_t cell;
+			// A robot on the cell stops the move on the previous one
+			bool stopBefore;
+		};
+
+		struct Path {
+			std::uint32_t first;
+			std::uint32_t length;
+			// The move ends on the last cell if no robot is in the way
+			bool stops;
+		};
+
+		Map m_map;
+		std::vector<Color> m_robots;
+		std::vector<std::uint32_t> m_cells;
+		unsigned m_bits;
+		BddManager m_bdd;
+		// By robot and cell
+		std::vector<BddManager::node_t> m_at;
+		std::vector<BddManager::node_t> m_occupied;
+		// By robot, cell and direction
+		std::vector<Path> m_paths;
+		std::vector<PathStep> m_pathSteps;
+
+		BddManager::node_t m_reached;
+		BddManager::node_t m_frontier;
+		std::size_t m_frontierNodes;
+		std::size_t m_collectAt;
+		std::vector<std::size_t> m_depthHistogram;
+
+		std::size_t cellCount() const {
+			return static_cast<std::size_t>(m_map.getWidth()) * m_map.getHeight();
+		}
+
+		BddManager::node_t image(BddManager::node_t states);
+		void collectGarbage(std::vector<BddManager::node_t*> const& temporaries = {});
+	};
+
+}